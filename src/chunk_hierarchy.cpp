@@ -0,0 +1,254 @@
+#include "chunk_hierarchy.hpp"
+#include "morton_order.hpp"
+
+#include "splat_renderer.hpp"
+
+#include <algorithm>
+
+using namespace Eigen;
+
+ChunkHierarchy::ChunkHierarchy()
+    : m_num_surfels(0), m_chunk_size(1)
+{
+}
+
+void
+ChunkHierarchy::build(std::vector<Surfel>& surfels, unsigned int chunk_size)
+{
+    clear();
+
+    if (surfels.empty() || chunk_size == 0)
+    {
+        return;
+    }
+
+    m_num_surfels = static_cast<unsigned int>(surfels.size());
+    m_chunk_size = chunk_size;
+
+    sort_morton(surfels);
+
+    unsigned int num_chunks = (m_num_surfels + m_chunk_size - 1)
+        / m_chunk_size;
+
+    m_nodes.reserve(2 * num_chunks);
+    m_leaves.resize(num_chunks);
+    m_centroids.resize(num_chunks);
+    build_node(surfels, 0, num_chunks);
+}
+
+void
+ChunkHierarchy::clear()
+{
+    m_nodes.clear();
+    m_leaves.clear();
+    m_centroids.clear();
+    m_num_surfels = 0;
+}
+
+unsigned int
+ChunkHierarchy::build_node(std::vector<Surfel> const& surfels,
+    unsigned int begin, unsigned int end)
+{
+    unsigned int index = static_cast<unsigned int>(m_nodes.size());
+    m_nodes.push_back(Node());
+
+    Node node;
+    node.begin = begin;
+    node.end = end;
+    node.right = 0;
+
+    if (end - begin == 1)
+    {
+        unsigned int first = begin * m_chunk_size;
+        unsigned int last = std::min(end * m_chunk_size, m_num_surfels);
+
+        node.box_min = node.box_max = surfels[first].c;
+        node.radius = 0.0f;
+
+        Vector3f centroid = Vector3f::Zero();
+
+        for (unsigned int i(first); i < last; ++i)
+        {
+            Surfel const& s = surfels[i];
+
+            node.box_min = node.box_min.cwiseMin(s.c);
+            node.box_max = node.box_max.cwiseMax(s.c);
+            node.radius = std::max(node.radius,
+                std::max(s.u.norm(), s.v.norm()));
+
+            centroid += s.c;
+        }
+
+        m_centroids[begin] = centroid / static_cast<float>(last - first);
+        m_leaves[begin] = index;
+    }
+    else
+    {
+        unsigned int mid = (begin + end) / 2;
+
+        unsigned int left = build_node(surfels, begin, mid);
+        node.right = build_node(surfels, mid, end);
+
+        Node const& l = m_nodes[left];
+        Node const& r = m_nodes[node.right];
+
+        node.box_min = l.box_min.cwiseMin(r.box_min);
+        node.box_max = l.box_max.cwiseMax(r.box_max);
+        node.radius = std::max(l.radius, r.radius);
+    }
+
+    m_nodes[index] = node;
+
+    return index;
+}
+
+void
+ChunkHierarchy::cull(Vector4f const* frustum_plane, float radius_scale,
+    std::vector<GLint>& first, std::vector<GLsizei>& count) const
+{
+    std::vector<ChunkRange> ranges;
+    traverse(frustum_plane, radius_scale, ranges);
+
+    for (ChunkRange const& range : ranges)
+    {
+        append(range.first, range.second, first, count);
+    }
+}
+
+void
+ChunkHierarchy::cull(Vector4f const* frustum_plane, float radius_scale,
+    Vector3f const& eye, std::vector<GLint>& first,
+    std::vector<GLsizei>& count) const
+{
+    std::vector<ChunkRange> ranges;
+    traverse(frustum_plane, radius_scale, ranges);
+
+    // Squared distance and index of every visible chunk.
+    std::vector<std::pair<float, unsigned int>> chunks;
+
+    for (ChunkRange const& range : ranges)
+    {
+        for (unsigned int i(range.first); i < range.second; ++i)
+        {
+            chunks.push_back(std::make_pair(
+                (m_centroids[i] - eye).squaredNorm(), i));
+        }
+    }
+
+    std::sort(chunks.begin(), chunks.end());
+
+    for (std::pair<float, unsigned int> const& chunk : chunks)
+    {
+        append(chunk.second, chunk.second + 1, first, count);
+    }
+}
+
+void
+ChunkHierarchy::traverse(Vector4f const* frustum_plane, float radius_scale,
+    std::vector<ChunkRange>& ranges) const
+{
+    if (m_nodes.empty())
+    {
+        return;
+    }
+
+    std::vector<unsigned int> stack(1, 0);
+
+    while (!stack.empty())
+    {
+        unsigned int index = stack.back();
+        stack.pop_back();
+
+        Node const& node = m_nodes[index];
+
+        Vector3f center = 0.5f * (node.box_min + node.box_max);
+        Vector3f half = 0.5f * (node.box_max - node.box_min);
+        float r = radius_scale * node.radius;
+
+        bool outside = false, inside = true;
+
+        for (unsigned int i(0); i < 6; ++i)
+        {
+            Vector3f n = frustum_plane[i].head<3>();
+
+            float d = n.dot(center) + frustum_plane[i].w();
+            float e = half.dot(n.cwiseAbs());
+
+            if (d + e < -r)
+            {
+                outside = true;
+                break;
+            }
+
+            if (d - e < r)
+            {
+                inside = false;
+            }
+        }
+
+        if (outside)
+        {
+            continue;
+        }
+
+        if (inside || node.right == 0)
+        {
+            ranges.push_back(ChunkRange(node.begin, node.end));
+        }
+        else
+        {
+            // Left subtree first keeps the ranges sorted for merging.
+            stack.push_back(node.right);
+            stack.push_back(index + 1);
+        }
+    }
+}
+
+void
+ChunkHierarchy::append(unsigned int chunk_begin, unsigned int chunk_end,
+    std::vector<GLint>& first, std::vector<GLsizei>& count) const
+{
+    GLint b = static_cast<GLint>(chunk_begin * m_chunk_size);
+    GLint e = static_cast<GLint>(std::min(chunk_end * m_chunk_size,
+        m_num_surfels));
+
+    if (!first.empty() && first.back() + count.back() == b)
+    {
+        count.back() += e - b;
+    }
+    else
+    {
+        first.push_back(b);
+        count.push_back(e - b);
+    }
+}
+
+unsigned int
+ChunkHierarchy::num_surfels() const
+{
+    return m_num_surfels;
+}
+
+unsigned int
+ChunkHierarchy::num_chunks() const
+{
+    return m_num_surfels == 0 ? 0
+        : (m_num_surfels + m_chunk_size - 1) / m_chunk_size;
+}
+
+unsigned int
+ChunkHierarchy::chunk_size() const
+{
+    return m_chunk_size;
+}
+
+void
+ChunkHierarchy::chunk_bounds(unsigned int chunk, Vector3f& box_min,
+    Vector3f& box_max, float& radius) const
+{
+    Node const& node = m_nodes[m_leaves[chunk]];
+
+    box_min = node.box_min;
+    box_max = node.box_max;
+    radius = node.radius;
+}
@@ -0,0 +1,74 @@
+#ifndef CHUNK_HIERARCHY_HPP
+#define CHUNK_HIERARCHY_HPP
+
+#include <GL/glew.h>
+#include <Eigen/Core>
+
+#include <utility>
+#include <vector>
+
+struct Surfel;
+
+// Bounding volume hierarchy over chunks of spatially sorted surfels. The
+// surfels are reordered along a Morton curve at load time so that every
+// chunk is a contiguous range of the vertex buffer and visible chunks can
+// be drawn with a single glMultiDrawArrays call.
+class ChunkHierarchy
+{
+
+public:
+    ChunkHierarchy();
+
+    void build(std::vector<Surfel>& surfels, unsigned int chunk_size = 1024);
+    void clear();
+
+    // Appends the ranges of chunks intersecting the frustum given by six
+    // normalized world space planes, adjacent ranges are merged. Splat
+    // radii are scaled the same way the vertex shader scales them.
+    void cull(Eigen::Vector4f const* frustum_plane, float radius_scale,
+        std::vector<GLint>& first, std::vector<GLsizei>& count) const;
+
+    // Same as above but with the visible chunks ordered front to back by
+    // the distance of their centroids to the eye position, only chunks
+    // adjacent in both the buffer and that order are merged.
+    void cull(Eigen::Vector4f const* frustum_plane, float radius_scale,
+        Eigen::Vector3f const& eye, std::vector<GLint>& first,
+        std::vector<GLsizei>& count) const;
+
+    unsigned int num_surfels() const;
+    unsigned int num_chunks() const;
+    unsigned int chunk_size() const;
+
+    // Box around the surfel centers of a chunk and its largest splat
+    // radius.
+    void chunk_bounds(unsigned int chunk, Eigen::Vector3f& box_min,
+        Eigen::Vector3f& box_max, float& radius) const;
+
+private:
+    struct Node
+    {
+        Eigen::Vector3f box_min, box_max;
+        float radius;
+
+        // Chunks [begin, end), inner nodes store the index of their right
+        // child, the left one immediately follows its parent.
+        unsigned int begin, end, right;
+    };
+
+    typedef std::pair<unsigned int, unsigned int> ChunkRange;
+
+    unsigned int build_node(std::vector<Surfel> const& surfels,
+        unsigned int begin, unsigned int end);
+    void traverse(Eigen::Vector4f const* frustum_plane, float radius_scale,
+        std::vector<ChunkRange>& ranges) const;
+    void append(unsigned int chunk_begin, unsigned int chunk_end,
+        std::vector<GLint>& first, std::vector<GLsizei>& count) const;
+
+private:
+    std::vector<Node> m_nodes;
+    std::vector<unsigned int> m_leaves;
+    std::vector<Eigen::Vector3f> m_centroids;
+    unsigned int m_num_surfels, m_chunk_size;
+};
+
+#endif // CHUNK_HIERARCHY_HPP
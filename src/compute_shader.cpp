@@ -0,0 +1,6 @@
+#include "compute_shader.hpp"
+
+ComputeShader::ComputeShader()
+{
+    m_shader_obj = glCreateShader(GL_COMPUTE_SHADER);
+}
@@ -0,0 +1,15 @@
+#ifndef COMPUTE_SHADER_HPP
+#define COMPUTE_SHADER_HPP
+
+#include <GLviz/program.hpp>
+
+// GLviz only wraps vertex, geometry and fragment shader objects, compute
+// shaders (OpenGL 4.3) share everything but the shader type with them.
+class ComputeShader : public glShader
+{
+
+public:
+    ComputeShader();
+};
+
+#endif // COMPUTE_SHADER_HPP
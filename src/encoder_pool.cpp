@@ -0,0 +1,136 @@
+#include "encoder_pool.hpp"
+
+#include <utility>
+
+EncoderPool::EncoderPool(unsigned int num_threads, std::size_t memory_cap)
+    : m_memory_cap(memory_cap), m_bytes(0), m_jobs(0), m_stop(false)
+{
+    for (unsigned int i(0); i < num_threads; ++i)
+    {
+        m_threads.emplace_back(&EncoderPool::work, this);
+    }
+}
+
+EncoderPool::~EncoderPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_queued.notify_all();
+
+    // Queued jobs still run, their outputs are not lost on failure of
+    // another one.
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+unsigned int
+EncoderPool::num_threads() const
+{
+    return static_cast<unsigned int>(m_threads.size());
+}
+
+void
+EncoderPool::submit(Job job, std::size_t bytes)
+{
+    if (m_threads.empty())
+    {
+        job();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_finished.wait(lock, [this, bytes]()
+    {
+        return m_error || m_jobs == 0 || m_bytes + bytes <= m_memory_cap;
+    });
+
+    rethrow();
+
+    m_queue.emplace_back(std::move(job), bytes);
+    m_bytes += bytes;
+    ++m_jobs;
+
+    lock.unlock();
+    m_queued.notify_one();
+}
+
+void
+EncoderPool::finish()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_finished.wait(lock, [this]()
+    {
+        return m_jobs == 0;
+    });
+
+    rethrow();
+}
+
+void
+EncoderPool::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_queued.wait(lock, [this]()
+        {
+            return m_stop || !m_queue.empty();
+        });
+
+        if (m_queue.empty())
+        {
+            return;
+        }
+
+        std::pair<Job, std::size_t> job = std::move(m_queue.front());
+        m_queue.pop_front();
+
+        lock.unlock();
+
+        std::exception_ptr error;
+
+        try
+        {
+            job.first();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        // Releases the images before the memory is accounted as free.
+        job.first = nullptr;
+
+        lock.lock();
+
+        if (error && !m_error)
+        {
+            m_error = error;
+        }
+
+        m_bytes -= job.second;
+        --m_jobs;
+
+        m_finished.notify_all();
+    }
+}
+
+void
+EncoderPool::rethrow()
+{
+    if (m_error)
+    {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+
+        std::rethrow_exception(error);
+    }
+}
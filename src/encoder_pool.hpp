@@ -0,0 +1,56 @@
+#ifndef ENCODER_POOL_HPP
+#define ENCODER_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads encoding and writing output files off the render thread. Jobs own
+// the images they write and are accounted with their size, a job that would
+// exceed the memory cap of the queued and running jobs waits until enough
+// of them finished. This bounds the memory and lets the renderer fall back
+// to the pace of the disk.
+class EncoderPool
+{
+
+public:
+    typedef std::function<void()> Job;
+
+    // Without threads jobs run right away on the submitting thread.
+    EncoderPool(unsigned int num_threads, std::size_t memory_cap);
+    ~EncoderPool();
+
+    unsigned int num_threads() const;
+
+    // A single job larger than the cap is only queued once all others
+    // finished. Rethrows the failure of an earlier job.
+    void submit(Job job, std::size_t bytes);
+
+    // Waits for all jobs and rethrows the first failure among them.
+    void finish();
+
+private:
+    void work();
+    void rethrow();
+
+private:
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_queued, m_finished;
+    std::deque<std::pair<Job, std::size_t>> m_queue;
+
+    // Bytes held by queued and running jobs and the number of both.
+    std::size_t m_memory_cap, m_bytes;
+    unsigned int m_jobs;
+
+    bool m_stop;
+    std::exception_ptr m_error;
+};
+
+#endif // ENCODER_POOL_HPP
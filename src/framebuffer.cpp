@@ -32,12 +32,13 @@ struct Framebuffer::Impl
     virtual void allocate_depth_texture(GLuint texture,
         GLsizei width, GLsizei height) = 0;
     virtual void allocate_rgba_texture(GLuint texture,
-        GLsizei width, GLsizei height) = 0;
+        GLenum internalformat, GLsizei width, GLsizei height) = 0;
     virtual void resize_rgba_texture(GLuint texture,
         GLsizei width, GLsizei height) = 0;
     virtual void resize_depth_texture(GLuint texture,
         GLsizei width, GLsizei height) = 0;
-    virtual bool multisample() const = 0;
+    virtual GLsizei samples() const = 0;
+    virtual GLsizei layers() const = 0;
 };
 
 struct Framebuffer::Default : public Framebuffer::Impl
@@ -69,12 +70,12 @@ struct Framebuffer::Default : public Framebuffer::Impl
     }
 
     void allocate_rgba_texture(GLuint texture,
-        GLsizei width, GLsizei height)
+        GLenum internalformat, GLsizei width, GLsizei height)
     {
         glBindTexture(GL_TEXTURE_2D, texture);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F,
+        glTexImage2D(GL_TEXTURE_2D, 0, internalformat,
             width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
@@ -82,7 +83,11 @@ struct Framebuffer::Default : public Framebuffer::Impl
     void resize_rgba_texture(GLuint texture, GLsizei width, GLsizei height)
     {
         glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F,
+        GLint internal_format;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0,
+            GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, internal_format,
             width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
         glBindTexture(GL_TEXTURE_2D, 0);
     }
@@ -95,14 +100,24 @@ struct Framebuffer::Default : public Framebuffer::Impl
         glBindTexture(GL_TEXTURE_2D, 0);
     }
 
-    bool multisample() const
+    GLsizei samples() const
+    {
+        return 1;
+    }
+
+    GLsizei layers() const
     {
-        return false;
+        return 0;
     }
 };
 
 struct Framebuffer::Multisample : public Framebuffer::Impl
 {
+    Multisample(GLsizei samples)
+        : m_samples(samples)
+    {
+    }
+
     void framebuffer_texture_2d(GLenum target,
     GLenum attachment, GLuint texture, GLint level)
     {
@@ -113,7 +128,7 @@ struct Framebuffer::Multisample : public Framebuffer::Impl
     void renderbuffer_storage(GLenum target,
         GLenum internalformat, GLsizei width, GLsizei height)
     {
-        glRenderbufferStorageMultisample(target, 4,
+        glRenderbufferStorageMultisample(target, m_samples,
             internalformat, width, height);
     }
 
@@ -121,17 +136,17 @@ struct Framebuffer::Multisample : public Framebuffer::Impl
         GLsizei width, GLsizei height)
     {
         glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture);
-        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, 4,
+        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, m_samples,
             GL_DEPTH_COMPONENT32F, width, height, GL_TRUE);
         glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
     }
 
     void allocate_rgba_texture(GLuint texture,
-        GLsizei width, GLsizei height)
+        GLenum internalformat, GLsizei width, GLsizei height)
     {
         glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture);
-        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, 4, GL_RGBA32F,
-            width, height, GL_TRUE);
+        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, m_samples,
+            internalformat, width, height, GL_TRUE);
         glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
     }
 
@@ -142,7 +157,7 @@ struct Framebuffer::Multisample : public Framebuffer::Impl
         glGetTexLevelParameteriv(GL_TEXTURE_2D_MULTISAMPLE, 0,
             GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
 
-        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, 4,
+        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, m_samples,
             internal_format, width, height, GL_TRUE);
         glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
     }
@@ -152,15 +167,107 @@ struct Framebuffer::Multisample : public Framebuffer::Impl
         resize_rgba_texture(texture, width, height);
     }
 
-    bool multisample() const
+    GLsizei samples() const
+    {
+        return m_samples;
+    }
+
+    GLsizei m_samples;
+
+    GLsizei layers() const
+    {
+        return 0;
+    }
+};
+
+struct Framebuffer::Layered : public Framebuffer::Impl
+{
+    Layered(GLsizei layers)
+        : m_layers(layers)
+    {
+    }
+
+    void framebuffer_texture_2d(GLenum target,
+        GLenum attachment, GLuint texture, GLint level)
+    {
+        glFramebufferTexture(target, attachment, texture, level);
+    }
+
+    void renderbuffer_storage(GLenum target,
+        GLenum internalformat, GLsizei width, GLsizei height)
+    {
+        glRenderbufferStorage(target, internalformat,
+            width, height);
+    }
+
+    void allocate_depth_texture(GLuint texture,
+        GLsizei width, GLsizei height)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+            GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+            GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE,
+            GL_NONE);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F,
+            width, height, m_layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT,
+            nullptr);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    void allocate_rgba_texture(GLuint texture,
+        GLenum internalformat, GLsizei width, GLsizei height)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+            GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+            GL_NEAREST);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalformat,
+            width, height, m_layers, 0, GL_RGBA, GL_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    void resize_rgba_texture(GLuint texture, GLsizei width, GLsizei height)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        GLint internal_format;
+        glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0,
+            GL_TEXTURE_INTERNAL_FORMAT, &internal_format);
+
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internal_format,
+            width, height, m_layers, 0, GL_RGBA, GL_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    void resize_depth_texture(GLuint texture, GLsizei width, GLsizei height)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F,
+            width, height, m_layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT,
+            nullptr);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+
+    GLsizei samples() const
     {
-        return true;
+        return 1;
     }
+
+    GLsizei layers() const
+    {
+        return m_layers;
+    }
+
+    GLsizei m_layers;
 };
 
 Framebuffer::Framebuffer()
     : m_fbo(0), m_color(0), m_normal(0), m_depth(0),
-      m_pimpl(new Default())
+      m_depth_texture(false), m_normal_texture(false),
+      m_color_format(GL_RGBA32F),
+      m_normal_format(GL_RGBA32F), m_pimpl(new Default())
 {
     // Create framebuffer object.
     glGenFramebuffers(1, &m_fbo);
@@ -186,9 +293,67 @@ Framebuffer::color_texture()
     return m_color;
 }
 
+GLenum
+Framebuffer::color_format() const
+{
+    return m_color_format;
+}
+
+void
+Framebuffer::set_color_format(GLenum internalformat)
+{
+    if (m_color_format != internalformat)
+    {
+        m_color_format = internalformat;
+
+        bind();
+
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        m_pimpl->framebuffer_texture_2d(GL_FRAMEBUFFER,
+            GL_COLOR_ATTACHMENT0, 0, 0);
+        glDeleteTextures(1, &m_color);
+
+        glGenTextures(1, &m_color);
+        m_pimpl->allocate_rgba_texture(m_color, m_color_format,
+            viewport[2], viewport[3]);
+        m_pimpl->framebuffer_texture_2d(GL_FRAMEBUFFER,
+            GL_COLOR_ATTACHMENT0, m_color, 0);
+
+        unbind();
+    }
+}
+
+GLenum
+Framebuffer::normal_format() const
+{
+    return m_normal_format;
+}
+
+void
+Framebuffer::set_normal_format(GLenum internalformat)
+{
+    if (m_normal_format != internalformat)
+    {
+        m_normal_format = internalformat;
+
+        if (m_normal_texture)
+        {
+            detach_normal_texture();
+            attach_normal_texture();
+        }
+    }
+}
+
 void
 Framebuffer::enable_depth_texture()
 {
+    if (m_depth_texture)
+    {
+        return;
+    }
+
     bind();
 
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
@@ -202,6 +367,7 @@ Framebuffer::enable_depth_texture()
     m_pimpl->allocate_depth_texture(m_depth, viewport[2], viewport[3]);
     m_pimpl->framebuffer_texture_2d(GL_FRAMEBUFFER,
         GL_DEPTH_ATTACHMENT, m_depth, 0);
+    m_depth_texture = true;
 
     unbind();
 }
@@ -209,6 +375,12 @@ Framebuffer::enable_depth_texture()
 void
 Framebuffer::disable_depth_texture()
 {
+    // Renderbuffers can not be attached to a layered framebuffer.
+    if (m_pimpl->layers() > 0)
+    {
+        return;
+    }
+
     bind();
 
     m_pimpl->framebuffer_texture_2d(GL_FRAMEBUFFER,
@@ -226,10 +398,17 @@ Framebuffer::disable_depth_texture()
 
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
         GL_RENDERBUFFER, m_depth);
+    m_depth_texture = false;
 
     unbind();
 }
 
+bool
+Framebuffer::depth_texture_enabled() const
+{
+    return m_depth_texture;
+}
+
 GLuint
 Framebuffer::depth_texture()
 {
@@ -245,12 +424,14 @@ Framebuffer::attach_normal_texture()
     glGetIntegerv(GL_VIEWPORT, viewport);
 
     glGenTextures(1, &m_normal);
-    m_pimpl->allocate_rgba_texture(m_normal, viewport[2], viewport[3]);
+    m_pimpl->allocate_rgba_texture(m_normal, m_normal_format,
+        viewport[2], viewport[3]);
     m_pimpl->framebuffer_texture_2d(GL_FRAMEBUFFER,
         GL_COLOR_ATTACHMENT1, m_normal, 0);
 
     GLenum buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
     glDrawBuffers(2, buffers);
+    m_normal_texture = true;
 
     unbind();
 }
@@ -266,10 +447,17 @@ Framebuffer::detach_normal_texture()
 
     GLenum buffers[] = { GL_COLOR_ATTACHMENT0 };
     glDrawBuffers(1, buffers);
+    m_normal_texture = false;
 
     unbind();
 }
 
+bool
+Framebuffer::normal_texture_attached() const
+{
+    return m_normal_texture;
+}
+
 GLuint
 Framebuffer::normal_texture()
 {
@@ -277,53 +465,127 @@ Framebuffer::normal_texture()
 }
 
 void
-Framebuffer::set_multisample(bool enable)
+Framebuffer::set_samples(GLsizei samples)
 {
-    if (m_pimpl->multisample() != enable)
+    if (m_pimpl->samples() != samples)
     {
-        bind();
+        if (samples > 1)
+        {
+            replace_impl(new Framebuffer::Multisample(samples));
+        }
+        else
+        {
+            replace_impl(new Framebuffer::Default());
+        }
+    }
+}
 
-        GLint type;
-        glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER,
-            GL_COLOR_ATTACHMENT1, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+GLsizei
+Framebuffer::samples() const
+{
+    return m_pimpl->samples();
+}
+
+Framebuffer&
+Framebuffer::resolve()
+{
+    if (m_pimpl->samples() == 1)
+    {
+        return *this;
+    }
 
-        remove_and_delete_attachments();
+    if (!m_resolved)
+    {
+        m_resolved = std::unique_ptr<Framebuffer>(new Framebuffer());
+    }
+
+    m_resolved->set_color_format(m_color_format);
+
+    // Depth is copied from one of the samples, which requires matching
+    // formats and thus a depth texture on both sides.
+    GLbitfield mask = GL_COLOR_BUFFER_BIT;
+    if (m_depth_texture)
+    {
+        m_resolved->enable_depth_texture();
+        mask |= GL_DEPTH_BUFFER_BIT;
+    }
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_resolved->m_fbo);
+    glBlitFramebuffer(0, 0, viewport[2], viewport[3],
+        0, 0, viewport[2], viewport[3], mask, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return *m_resolved;
+}
 
-        if (m_pimpl->multisample())
+void
+Framebuffer::set_layers(GLsizei layers)
+{
+    if (m_pimpl->layers() != layers)
+    {
+        if (layers > 0)
         {
-            m_pimpl = std::unique_ptr<Framebuffer::Impl>(
-                new Framebuffer::Default());
+            replace_impl(new Framebuffer::Layered(layers));
         }
         else
         {
-            m_pimpl = std::unique_ptr<Framebuffer::Impl>(
-                new Framebuffer::Multisample());
+            replace_impl(new Framebuffer::Default());
         }
+    }
+}
 
-        initialize();
-        if (type == GL_TEXTURE)
-        {
-            attach_normal_texture();
-            enable_depth_texture();
-        }
+GLsizei
+Framebuffer::layers() const
+{
+    return m_pimpl->layers();
+}
+
+void
+Framebuffer::replace_impl(Impl* impl)
+{
+    bind();
+
+    GLint type;
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER,
+        GL_COLOR_ATTACHMENT1, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+    bool depth_texture = m_depth_texture;
+
+    remove_and_delete_attachments();
+    m_normal_texture = false;
+
+    m_pimpl = std::unique_ptr<Framebuffer::Impl>(impl);
+
+    initialize();
+    if (type == GL_TEXTURE)
+    {
+        attach_normal_texture();
+    }
+
+    if (depth_texture && !m_depth_texture)
+    {
+        enable_depth_texture();
+    }
 
 #ifndef NDEBUG
-        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-        if (status != GL_FRAMEBUFFER_COMPLETE)
-        {
-            std::cerr << __FILE__ << "(" << __LINE__ << "): "
-                << GLviz::get_gl_framebuffer_status_string(status) << std::endl;
-        }
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cerr << __FILE__ << "(" << __LINE__ << "): "
+            << GLviz::get_gl_framebuffer_status_string(status) << std::endl;
+    }
 
-        GLenum gl_error = glGetError();
-        if (GL_NO_ERROR != gl_error)
-        {
-            std::cerr << __FILE__ << "(" << __LINE__ << "): "
-                << GLviz::get_gl_error_string(gl_error) << std::endl;
-        }
-#endif
-        unbind();
+    GLenum gl_error = glGetError();
+    if (GL_NO_ERROR != gl_error)
+    {
+        std::cerr << __FILE__ << "(" << __LINE__ << "): "
+            << GLviz::get_gl_error_string(gl_error) << std::endl;
     }
+#endif
+    unbind();
 }
 
 void
@@ -341,6 +603,11 @@ Framebuffer::unbind()
 void
 Framebuffer::reshape(GLint width, GLint height)
 {
+    if (m_resolved)
+    {
+        m_resolved->reshape(width, height);
+    }
+
     bind();
 
     GLenum attachment[2] = {
@@ -417,18 +684,32 @@ Framebuffer::initialize()
 
     // Attach color texture to framebuffer object.
     glGenTextures(1, &m_color);
-    m_pimpl->allocate_rgba_texture(m_color, viewport[2], viewport[3]);
+    m_pimpl->allocate_rgba_texture(m_color, m_color_format,
+        viewport[2], viewport[3]);
     m_pimpl->framebuffer_texture_2d(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
         m_color, 0);
 
-    // Attach renderbuffer object to framebuffer object.
-    glGenRenderbuffers(1, &m_depth);
-    glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
-    m_pimpl->renderbuffer_storage(GL_RENDERBUFFER,
-        GL_DEPTH_COMPONENT32F, viewport[2], viewport[3]);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
-        GL_RENDERBUFFER, m_depth);
+    if (m_pimpl->layers() > 0)
+    {
+        // All attachments of a layered framebuffer have to be layered.
+        glGenTextures(1, &m_depth);
+        m_pimpl->allocate_depth_texture(m_depth, viewport[2], viewport[3]);
+        m_pimpl->framebuffer_texture_2d(GL_FRAMEBUFFER,
+            GL_DEPTH_ATTACHMENT, m_depth, 0);
+        m_depth_texture = true;
+    }
+    else
+    {
+        // Attach renderbuffer object to framebuffer object.
+        glGenRenderbuffers(1, &m_depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depth);
+        m_pimpl->renderbuffer_storage(GL_RENDERBUFFER,
+            GL_DEPTH_COMPONENT32F, viewport[2], viewport[3]);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+            GL_RENDERBUFFER, m_depth);
+        m_depth_texture = false;
+    }
 
     GLenum buffers[] = { GL_COLOR_ATTACHMENT0 };
     glDrawBuffers(1, buffers);
@@ -30,15 +30,39 @@ public:
 
     GLuint color_texture();
 
+    // Internal formats of the color and the normal attachment, GL_RGBA32F
+    // unless set otherwise. Changing a format reallocates the attachment.
+    GLenum color_format() const;
+    void set_color_format(GLenum internalformat);
+    GLenum normal_format() const;
+    void set_normal_format(GLenum internalformat);
+
     void enable_depth_texture();
     void disable_depth_texture();
+    bool depth_texture_enabled() const;
     GLuint depth_texture();
 
     void attach_normal_texture();
     void detach_normal_texture();
+    bool normal_texture_attached() const;
     GLuint normal_texture();
 
-    void set_multisample(bool enable = true);
+    // Allocates multisampled attachments with the given number of
+    // samples, one restores single sampled ones.
+    void set_samples(GLsizei samples);
+    GLsizei samples() const;
+
+    // Single sampled copy of the color and, if enabled, the depth texture
+    // of a multisampled framebuffer at the size of the viewport. Returns
+    // the framebuffer itself unless multisampled.
+    Framebuffer& resolve();
+
+    // Allocates all attachments as 2D array textures with the given number
+    // of layers for layered rendering, zero restores plain 2D textures.
+    // Layered framebuffers always have a depth texture and are never
+    // multisampled.
+    void set_layers(GLsizei layers);
+    GLsizei layers() const;
 
     void bind();
     void unbind();
@@ -48,14 +72,20 @@ private:
     void initialize();
     void remove_and_delete_attachments();
 
+    struct Impl;
+    void replace_impl(Impl* impl);
+
     GLuint m_fbo;
     GLuint m_color, m_normal, m_depth;
+    bool m_depth_texture, m_normal_texture;
+    GLenum m_color_format, m_normal_format;
 
-    struct Impl;
     struct Default;
     struct Multisample;
+    struct Layered;
 
     std::unique_ptr<Impl> m_pimpl;
+    std::unique_ptr<Framebuffer> m_resolved;
 };
 
 #endif // FRAMEBUFFER_HPP
@@ -0,0 +1,129 @@
+#include "framebuffer_pool.hpp"
+
+#include <algorithm>
+
+namespace
+{
+
+std::size_t
+bytes_per_pixel(GLenum internalformat)
+{
+    switch (internalformat)
+    {
+        case GL_RGBA8:
+            return 4;
+
+        case GL_RGBA16F:
+            return 8;
+
+        case GL_RGBA32F:
+        default:
+            return 16;
+    }
+}
+
+}
+
+bool
+FramebufferPool::Key::operator==(Key const& other) const
+{
+    return width == other.width && height == other.height
+        && color_format == other.color_format
+        && samples == other.samples && layers == other.layers;
+}
+
+FramebufferPool::FramebufferPool(std::size_t capacity)
+    : m_capacity(capacity)
+{
+}
+
+Framebuffer&
+FramebufferPool::acquire(Key const& key)
+{
+    auto it = std::find_if(m_entries.begin(), m_entries.end(),
+        [&key](Entry const& entry) { return entry.key == key; });
+
+    if (it != m_entries.end())
+    {
+        m_entries.splice(m_entries.begin(), m_entries, it);
+    }
+    else
+    {
+        Entry entry;
+        entry.key = key;
+        entry.framebuffer = std::unique_ptr<Framebuffer>(new Framebuffer());
+        entry.framebuffer->set_color_format(key.color_format);
+        entry.framebuffer->set_samples(key.samples);
+        entry.framebuffer->set_layers(key.layers);
+
+        m_entries.push_front(std::move(entry));
+    }
+
+    evict();
+
+    return *m_entries.front().framebuffer;
+}
+
+std::size_t
+FramebufferPool::capacity() const
+{
+    return m_capacity;
+}
+
+void
+FramebufferPool::set_capacity(std::size_t capacity)
+{
+    m_capacity = capacity;
+    evict();
+}
+
+std::size_t
+FramebufferPool::num_framebuffers() const
+{
+    return m_entries.size();
+}
+
+std::size_t
+FramebufferPool::size_in_bytes() const
+{
+    std::size_t size = 0;
+    for (Entry const& entry : m_entries)
+    {
+        size += estimate_size(entry);
+    }
+
+    return size;
+}
+
+std::size_t
+FramebufferPool::estimate_size(Entry const& entry)
+{
+    Key const& key = entry.key;
+    Framebuffer const& framebuffer = *entry.framebuffer;
+
+    // Color and 32 bit depth per sample, plus the normals when attached.
+    std::size_t per_sample = bytes_per_pixel(key.color_format) + 4;
+    if (framebuffer.normal_texture_attached())
+    {
+        per_sample += bytes_per_pixel(framebuffer.normal_format());
+    }
+
+    std::size_t samples = std::max<GLsizei>(key.samples, 1);
+    std::size_t layers = std::max<GLsizei>(key.layers, 1);
+
+    return static_cast<std::size_t>(key.width)
+        * static_cast<std::size_t>(key.height) * samples * layers
+        * per_sample;
+}
+
+void
+FramebufferPool::evict()
+{
+    std::size_t size = size_in_bytes();
+
+    while (m_entries.size() > 1 && size > m_capacity)
+    {
+        size -= estimate_size(m_entries.back());
+        m_entries.pop_back();
+    }
+}
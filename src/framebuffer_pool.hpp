@@ -0,0 +1,59 @@
+#ifndef FRAMEBUFFER_POOL_HPP
+#define FRAMEBUFFER_POOL_HPP
+
+#include "framebuffer.hpp"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <list>
+#include <memory>
+
+// Framebuffers of recently used configurations. Switching between them
+// avoids reallocating all attachments whenever the resolution or a format
+// changes from one frame to the next. The least recently used ones are
+// released once the estimated memory of all of them exceeds the capacity,
+// the most recently acquired framebuffer is always kept.
+class FramebufferPool
+{
+
+public:
+    struct Key
+    {
+        GLsizei width, height;
+        GLenum color_format;
+        GLsizei samples;
+        GLsizei layers;
+
+        bool operator==(Key const& other) const;
+    };
+
+    explicit FramebufferPool(std::size_t capacity = 512u << 20);
+
+    // Framebuffers are created at the size of the viewport, which thus has
+    // to match the key. Acquiring may release any other framebuffer.
+    Framebuffer& acquire(Key const& key);
+
+    std::size_t capacity() const;
+    void set_capacity(std::size_t capacity);
+
+    std::size_t num_framebuffers() const;
+    std::size_t size_in_bytes() const;
+
+private:
+    struct Entry
+    {
+        Key key;
+        std::unique_ptr<Framebuffer> framebuffer;
+    };
+
+    static std::size_t estimate_size(Entry const& entry);
+    void evict();
+
+private:
+    // Most recently used first.
+    std::list<Entry> m_entries;
+    std::size_t m_capacity;
+};
+
+#endif // FRAMEBUFFER_POOL_HPP
@@ -0,0 +1,248 @@
+#include "gpu_timer.hpp"
+
+GpuTimer::Timings::Timings()
+    : total(0.0), frame(0)
+{
+    for (unsigned int i(0); i < num_passes; ++i)
+    {
+        pass[i] = -1.0;
+    }
+}
+
+GpuTimer::GpuTimer()
+    : m_slot(num_frames - 1), m_frame(0), m_open(false), m_oldest(0)
+{
+    glGenQueries(num_frames * num_passes * 2, m_queries);
+
+    for (unsigned int i(0); i < num_frames; ++i)
+    {
+        m_frames[i].number = 0;
+        m_frames[i].pending = false;
+    }
+}
+
+GpuTimer::~GpuTimer()
+{
+    glDeleteQueries(num_frames * num_passes * 2, m_queries);
+}
+
+char const*
+GpuTimer::name(Pass pass)
+{
+    switch (pass)
+    {
+        case culling_pass:
+            return "culling";
+        case visibility_pass:
+            return "visibility";
+        case occlusion_pass:
+            return "occlusion";
+        case attribute_pass:
+            return "attribute";
+        case rasterization_pass:
+            return "rasterization";
+        case hole_filling_pass:
+            return "hole filling";
+        case finalization_pass:
+            return "finalization";
+        case readback_pass:
+            return "readback";
+        default:
+            return "";
+    }
+}
+
+void
+GpuTimer::begin_frame()
+{
+    end_frame();
+
+    m_slot = (m_slot + 1) % num_frames;
+
+    Frame& frame = m_frames[m_slot];
+
+    if (frame.pending)
+    {
+        // Collect what is available, the rest of the ring is newer.
+        poll();
+
+        if (frame.pending)
+        {
+            frame.pending = false;
+            m_oldest = (m_slot + 1) % num_frames;
+        }
+    }
+
+    frame.number = ++m_frame;
+    frame.timings = Timings();
+    for (unsigned int i(0); i < num_passes; ++i)
+    {
+        frame.recorded[i] = false;
+    }
+
+    m_open = true;
+}
+
+void
+GpuTimer::end_frame()
+{
+    if (!m_open)
+    {
+        return;
+    }
+
+    Frame& frame = m_frames[m_slot];
+
+    for (unsigned int i(0); i < num_passes; ++i)
+    {
+        frame.pending = frame.pending || frame.recorded[i];
+    }
+
+    m_open = false;
+}
+
+void
+GpuTimer::begin(Pass pass)
+{
+    if (m_open)
+    {
+        glQueryCounter(query(m_slot, pass, false), GL_TIMESTAMP);
+    }
+}
+
+void
+GpuTimer::end(Pass pass)
+{
+    if (m_open)
+    {
+        glQueryCounter(query(m_slot, pass, true), GL_TIMESTAMP);
+        m_frames[m_slot].recorded[pass] = true;
+    }
+}
+
+GpuTimer::Timings const&
+GpuTimer::timings() const
+{
+    poll();
+
+    return m_timings;
+}
+
+std::uint64_t
+GpuTimer::frame() const
+{
+    return m_frame;
+}
+
+GpuTimer::Timings const*
+GpuTimer::timings(std::uint64_t number) const
+{
+    for (unsigned int i(0); i < num_frames; ++i)
+    {
+        Frame& frame = m_frames[i];
+
+        if (frame.number != number || (i == m_slot && m_open))
+        {
+            continue;
+        }
+
+        if (frame.pending)
+        {
+            resolve(i);
+        }
+
+        return frame.timings.frame == number ? &frame.timings : nullptr;
+    }
+
+    return nullptr;
+}
+
+GLuint
+GpuTimer::query(unsigned int slot, Pass pass, bool end) const
+{
+    return m_queries[2 * (slot * num_passes + pass) + (end ? 1 : 0)];
+}
+
+void
+GpuTimer::poll() const
+{
+    // Frames complete in order, stop at the first one still in flight.
+    for (unsigned int n(0); n < num_frames; ++n)
+    {
+        Frame& frame = m_frames[m_oldest];
+
+        if (m_oldest == m_slot && m_open)
+        {
+            break;
+        }
+
+        if (frame.pending)
+        {
+            for (unsigned int i(0); i < num_passes; ++i)
+            {
+                if (!frame.recorded[i])
+                {
+                    continue;
+                }
+
+                GLint available;
+                glGetQueryObjectiv(query(m_oldest, static_cast<Pass>(i),
+                    true), GL_QUERY_RESULT_AVAILABLE, &available);
+
+                if (!available)
+                {
+                    return;
+                }
+            }
+
+            resolve(m_oldest);
+        }
+
+        if (m_oldest == m_slot)
+        {
+            break;
+        }
+
+        m_oldest = (m_oldest + 1) % num_frames;
+    }
+}
+
+void
+GpuTimer::resolve(unsigned int slot) const
+{
+    Frame& frame = m_frames[slot];
+
+    Timings timings;
+    GLuint64 first = ~GLuint64(0), last = 0;
+
+    for (unsigned int i(0); i < num_passes; ++i)
+    {
+        if (!frame.recorded[i])
+        {
+            continue;
+        }
+
+        GLuint64 begin, end;
+        glGetQueryObjectui64v(query(slot, static_cast<Pass>(i), false),
+            GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(query(slot, static_cast<Pass>(i), true),
+            GL_QUERY_RESULT, &end);
+
+        timings.pass[i] = 1e-6 * static_cast<double>(end - begin);
+
+        first = begin < first ? begin : first;
+        last = end > last ? end : last;
+    }
+
+    timings.total = 1e-6 * static_cast<double>(last - first);
+    timings.frame = frame.number;
+
+    frame.timings = timings;
+    frame.pending = false;
+
+    // Frames may be resolved out of order on request.
+    if (timings.frame > m_timings.frame)
+    {
+        m_timings = timings;
+    }
+}
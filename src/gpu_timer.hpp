@@ -0,0 +1,93 @@
+#ifndef GPU_TIMER_HPP
+#define GPU_TIMER_HPP
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+// Timestamp queries around the passes of a frame. Queries of the last few
+// frames are kept in flight and results are only read once the GPU has
+// made them available, so timing never stalls the pipeline. A frame whose
+// queries are still pending when its slot is needed again is dropped.
+class GpuTimer
+{
+
+public:
+    enum Pass
+    {
+        culling_pass, visibility_pass, occlusion_pass, attribute_pass,
+        rasterization_pass, hole_filling_pass, finalization_pass,
+        readback_pass, num_passes
+    };
+
+    struct Timings
+    {
+        Timings();
+
+        // Milliseconds per pass, negative for passes the frame skipped.
+        double pass[num_passes];
+
+        // Milliseconds from the beginning of the first to the end of the
+        // last pass of the frame.
+        double total;
+
+        // Number of the frame, zero until a frame completed.
+        std::uint64_t frame;
+    };
+
+    static unsigned int const num_frames = 4;
+
+    GpuTimer();
+    ~GpuTimer();
+
+    static char const* name(Pass pass);
+
+    // Closes the previous frame and starts recording the next one.
+    void begin_frame();
+    void end_frame();
+
+    // A pass is timed at most once per frame, repeating it overwrites the
+    // earlier time.
+    void begin(Pass pass);
+    void end(Pass pass);
+
+    // Timings of the most recent frame whose queries completed.
+    Timings const& timings() const;
+
+    // Number of the frame recorded last.
+    std::uint64_t frame() const;
+
+    // Timings of the given frame, waiting for its queries. Meant for frames
+    // known to be finished on the GPU, e.g. once a fence after them
+    // signaled. Null if the frame timed nothing, was dropped or its slot
+    // was reused by a later frame.
+    Timings const* timings(std::uint64_t frame) const;
+
+private:
+    struct Frame
+    {
+        std::uint64_t number;
+        bool pending;
+        bool recorded[num_passes];
+        Timings timings;
+    };
+
+    GLuint query(unsigned int slot, Pass pass, bool end) const;
+    void poll() const;
+
+    // Reads the results of a pending frame, waiting for them if needed.
+    void resolve(unsigned int slot) const;
+
+private:
+    GLuint m_queries[num_frames * num_passes * 2];
+    mutable Frame m_frames[num_frames];
+    unsigned int m_slot;
+    std::uint64_t m_frame;
+    bool m_open;
+
+    // Oldest frame that may still be pending.
+    mutable unsigned int m_oldest;
+    mutable Timings m_timings;
+};
+
+#endif // GPU_TIMER_HPP
@@ -0,0 +1,286 @@
+#include "image_encoder.hpp"
+#include "stb_image_write.h"
+
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+
+void
+append_u32(std::vector<unsigned char>& data, std::uint32_t value)
+{
+    data.push_back(static_cast<unsigned char>((value >> 24) & 0xff));
+    data.push_back(static_cast<unsigned char>((value >> 16) & 0xff));
+    data.push_back(static_cast<unsigned char>((value >> 8) & 0xff));
+    data.push_back(static_cast<unsigned char>(value & 0xff));
+}
+
+void
+append_png(void* context, void* data, int size)
+{
+    std::vector<unsigned char>& out
+        = *static_cast<std::vector<unsigned char>*>(context);
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+// Lossless "Quite OK Image" format, see https://qoiformat.org for the
+// specification. Pixels are coded as runs of the previous one, indices into
+// a hash table of recently seen ones, small differences to the previous one
+// or verbatim.
+void
+encode_qoi(unsigned char const* pixels, int width, int height,
+    int channels, std::vector<unsigned char>& data)
+{
+    unsigned char const op_index = 0x00, op_diff = 0x40, op_luma = 0x80,
+        op_run = 0xc0, op_rgb = 0xfe, op_rgba = 0xff;
+
+    int out_channels = channels == 4 ? 4 : 3;
+    std::size_t num_pixels = static_cast<std::size_t>(width) * height;
+
+    data.clear();
+    data.reserve(14 + num_pixels * (out_channels + 1) + 8);
+
+    data.insert(data.end(), { 'q', 'o', 'i', 'f' });
+    append_u32(data, static_cast<std::uint32_t>(width));
+    append_u32(data, static_cast<std::uint32_t>(height));
+    data.push_back(static_cast<unsigned char>(out_channels));
+    data.push_back(0);  // sRGB with linear alpha.
+
+    unsigned char index[64][4] = {};
+    unsigned char prev[4] = { 0, 0, 0, 255 };
+    unsigned int run = 0;
+
+    for (std::size_t i(0); i < num_pixels; ++i)
+    {
+        unsigned char const* p = pixels + i * channels;
+        unsigned char px[4];
+
+        if (channels == 1)
+        {
+            px[0] = px[1] = px[2] = p[0];
+            px[3] = 255;
+        }
+        else
+        {
+            px[0] = p[0];
+            px[1] = p[1];
+            px[2] = p[2];
+            px[3] = channels == 4 ? p[3] : 255;
+        }
+
+        bool same = px[0] == prev[0] && px[1] == prev[1]
+            && px[2] == prev[2] && px[3] == prev[3];
+
+        if (same)
+        {
+            ++run;
+
+            if (run == 62 || i + 1 == num_pixels)
+            {
+                data.push_back(static_cast<unsigned char>(op_run | (run - 1)));
+                run = 0;
+            }
+
+            continue;
+        }
+
+        if (run > 0)
+        {
+            data.push_back(static_cast<unsigned char>(op_run | (run - 1)));
+            run = 0;
+        }
+
+        unsigned int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11)
+            % 64;
+        unsigned char* entry = index[hash];
+
+        if (entry[0] == px[0] && entry[1] == px[1] && entry[2] == px[2]
+            && entry[3] == px[3])
+        {
+            data.push_back(static_cast<unsigned char>(op_index | hash));
+        }
+        else
+        {
+            for (unsigned int k(0); k < 4; ++k)
+            {
+                entry[k] = px[k];
+            }
+
+            if (px[3] == prev[3])
+            {
+                // Differences wrap around like the channels themselves.
+                int dr = static_cast<signed char>(px[0] - prev[0]);
+                int dg = static_cast<signed char>(px[1] - prev[1]);
+                int db = static_cast<signed char>(px[2] - prev[2]);
+                int dr_dg = dr - dg, db_dg = db - dg;
+
+                if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3
+                    && db < 2)
+                {
+                    data.push_back(static_cast<unsigned char>(op_diff
+                        | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+                }
+                else if (dr_dg > -9 && dr_dg < 8 && dg > -33 && dg < 32
+                    && db_dg > -9 && db_dg < 8)
+                {
+                    data.push_back(static_cast<unsigned char>(op_luma
+                        | (dg + 32)));
+                    data.push_back(static_cast<unsigned char>(
+                        (dr_dg + 8) << 4 | (db_dg + 8)));
+                }
+                else
+                {
+                    data.insert(data.end(), { op_rgb, px[0], px[1], px[2] });
+                }
+            }
+            else
+            {
+                data.insert(data.end(),
+                    { op_rgba, px[0], px[1], px[2], px[3] });
+            }
+        }
+
+        for (unsigned int k(0); k < 4; ++k)
+        {
+            prev[k] = px[k];
+        }
+    }
+
+    data.insert(data.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+}
+
+// Netpbm PAM, a short text header followed by the raw rows.
+void
+encode_pam(unsigned char const* pixels, int width, int height,
+    int channels, std::vector<unsigned char>& data)
+{
+    char const* tuple_type = channels == 1 ? "GRAYSCALE"
+        : channels == 3 ? "RGB" : "RGB_ALPHA";
+
+    std::string header = "P7\nWIDTH " + std::to_string(width)
+        + "\nHEIGHT " + std::to_string(height)
+        + "\nDEPTH " + std::to_string(channels)
+        + "\nMAXVAL 255\nTUPLTYPE " + tuple_type + "\nENDHDR\n";
+
+    std::size_t size = static_cast<std::size_t>(width) * height * channels;
+
+    data.assign(header.begin(), header.end());
+    data.insert(data.end(), pixels, pixels + size);
+}
+
+}
+
+ImageEncoder::ImageEncoder(Format format)
+    : m_format(format)
+{
+}
+
+char const*
+ImageEncoder::name(Format format)
+{
+    switch (format)
+    {
+        case png:
+            return "png";
+        case qoi:
+            return "qoi";
+        case pam:
+            return "pam";
+        default:
+            return "";
+    }
+}
+
+char const*
+ImageEncoder::extension(Format format)
+{
+    switch (format)
+    {
+        case png:
+            return ".png";
+        case qoi:
+            return ".qoi";
+        case pam:
+            return ".pam";
+        default:
+            return "";
+    }
+}
+
+bool
+ImageEncoder::parse(std::string const& name, Format& format)
+{
+    for (unsigned int i(0); i < num_formats; ++i)
+    {
+        if (name == ImageEncoder::name(static_cast<Format>(i)))
+        {
+            format = static_cast<Format>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+ImageEncoder::set_png_compression(int level, int filter)
+{
+    stbi_write_png_compression_level = level < 0 ? 8 : level;
+    stbi_write_force_png_filter = filter;
+}
+
+int
+ImageEncoder::png_level()
+{
+    return stbi_write_png_compression_level;
+}
+
+ImageEncoder::Format
+ImageEncoder::format() const
+{
+    return m_format;
+}
+
+void
+ImageEncoder::encode(unsigned char const* pixels, int width, int height,
+    int channels, std::vector<unsigned char>& data) const
+{
+    switch (m_format)
+    {
+        case png:
+            data.clear();
+            if (!stbi_write_png_to_func(append_png, &data, width, height,
+                channels, pixels, width * channels))
+            {
+                throw std::runtime_error("png error: failed to encode image");
+            }
+            break;
+        case qoi:
+            encode_qoi(pixels, width, height, channels, data);
+            break;
+        default:
+            encode_pam(pixels, width, height, channels, data);
+            break;
+    }
+}
+
+void
+ImageEncoder::write(std::string const& filename, unsigned char const* pixels,
+    int width, int height, int channels) const
+{
+    std::vector<unsigned char> data;
+    encode(pixels, width, height, channels, data);
+
+    std::ofstream file(filename, std::ofstream::binary);
+
+    if (!file)
+    {
+        throw std::runtime_error("io error: failed to open " + filename);
+    }
+
+    file.write(reinterpret_cast<char const*>(data.data()), data.size());
+}
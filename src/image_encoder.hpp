@@ -0,0 +1,49 @@
+#ifndef IMAGE_ENCODER_HPP
+#define IMAGE_ENCODER_HPP
+
+#include <string>
+#include <vector>
+
+// Encodes the 8 bit color images and depth previews of the rendered views.
+// PNG trades throughput for size, QOI is a simple lossless codec several
+// times faster than deflate and PAM stores the pixels uncompressed.
+class ImageEncoder
+{
+
+public:
+    enum Format
+    {
+        png, qoi, pam, num_formats
+    };
+
+    explicit ImageEncoder(Format format = png);
+
+    static char const* name(Format format);
+
+    // Extension of the files of a format including the dot.
+    static char const* extension(Format format);
+
+    // Format of the given name, false if there is none.
+    static bool parse(std::string const& name, Format& format);
+
+    // Deflate level from 0 to 9 and row filter of PNG, -1 keeps the
+    // default level and chooses a filter per row. The settings are global,
+    // they have to be set before encoding on several threads.
+    static void set_png_compression(int level, int filter);
+    static int png_level();
+
+    Format format() const;
+
+    // Encodes a top-down image of 1, 3 or 4 channels, QOI stores gray
+    // images as RGB.
+    void encode(unsigned char const* pixels, int width, int height,
+        int channels, std::vector<unsigned char>& data) const;
+
+    void write(std::string const& filename, unsigned char const* pixels,
+        int width, int height, int channels) const;
+
+private:
+    Format m_format;
+};
+
+#endif // IMAGE_ENCODER_HPP
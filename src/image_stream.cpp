@@ -0,0 +1,232 @@
+#include "image_stream.hpp"
+#include "npy.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+namespace
+{
+
+void
+write_u32(unsigned char* dst, unsigned long value)
+{
+    dst[0] = static_cast<unsigned char>((value >> 24) & 0xff);
+    dst[1] = static_cast<unsigned char>((value >> 16) & 0xff);
+    dst[2] = static_cast<unsigned char>((value >> 8) & 0xff);
+    dst[3] = static_cast<unsigned char>(value & 0xff);
+}
+
+std::string
+partial_path(std::string const& filename)
+{
+    return filename + ".part";
+}
+
+// Closes a complete file and gives it its final name.
+void
+commit_partial(std::ofstream& file, std::string const& filename)
+{
+    file.close();
+
+    if (!file)
+    {
+        throw std::runtime_error("io error: failed to write " + filename);
+    }
+
+    std::filesystem::rename(partial_path(filename), filename);
+}
+
+void
+remove_partial(std::ofstream& file, std::string const& filename)
+{
+    file.close();
+
+    std::error_code error;
+    std::filesystem::remove(partial_path(filename), error);
+}
+
+}
+
+PngStream::PngStream(std::string const& filename, unsigned int width,
+    unsigned int height, unsigned int channels, int level)
+    : m_filename(filename),
+      m_file(partial_path(filename), std::ofstream::binary), m_width(width),
+      m_height(height), m_channels(channels), m_rows_written(0),
+      m_finished(false)
+{
+    if (!m_file)
+    {
+        throw std::runtime_error("io error: failed to open " + filename);
+    }
+
+    unsigned char const signature[8] = {
+        0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'
+    };
+    m_file.write(reinterpret_cast<char const*>(signature), 8);
+
+    // Color types 0, 4, 2 and 6 for gray, gray alpha, RGB and RGBA.
+    unsigned char const color_type[5] = { 0, 0, 4, 2, 6 };
+
+    unsigned char header[13];
+    write_u32(header, width);
+    write_u32(header + 4, height);
+    header[8] = 8;
+    header[9] = color_type[channels];
+    header[10] = header[11] = header[12] = 0;
+    write_chunk("IHDR", header, 13);
+
+    m_zstream.zalloc = Z_NULL;
+    m_zstream.zfree = Z_NULL;
+    m_zstream.opaque = Z_NULL;
+
+    if (deflateInit(&m_zstream, level) != Z_OK)
+    {
+        remove_partial(m_file, m_filename);
+        throw std::runtime_error("zlib error: failed to initialize deflate");
+    }
+
+    // Every row is prefixed by its filter type, none here.
+    m_row.resize(1 + m_width * m_channels);
+    m_out.resize(1 << 16);
+}
+
+PngStream::~PngStream()
+{
+    deflateEnd(&m_zstream);
+
+    if (!m_finished)
+    {
+        remove_partial(m_file, m_filename);
+    }
+}
+
+void
+PngStream::write_rows(unsigned char const* rows, unsigned int num_rows)
+{
+    std::size_t const row_size = m_width * m_channels;
+
+    for (unsigned int i(0); i < num_rows && m_rows_written < m_height; ++i)
+    {
+        m_row[0] = 0;
+        std::copy(rows + i * row_size, rows + (i + 1) * row_size,
+            m_row.begin() + 1);
+
+        m_zstream.next_in = m_row.data();
+        m_zstream.avail_in = static_cast<uInt>(m_row.size());
+        deflate_rows(Z_NO_FLUSH);
+
+        ++m_rows_written;
+    }
+}
+
+void
+PngStream::finish()
+{
+    if (m_rows_written < m_height)
+    {
+        throw std::runtime_error("png error: rows missing in "
+            + m_filename);
+    }
+
+    deflate_rows(Z_FINISH);
+    write_chunk("IEND", nullptr, 0);
+
+    commit_partial(m_file, m_filename);
+    m_finished = true;
+}
+
+void
+PngStream::deflate_rows(int flush)
+{
+    // Every full output buffer becomes an IDAT chunk of its own.
+    int status;
+
+    do
+    {
+        m_zstream.next_out = m_out.data();
+        m_zstream.avail_out = static_cast<uInt>(m_out.size());
+
+        status = deflate(&m_zstream, flush);
+
+        std::size_t size = m_out.size() - m_zstream.avail_out;
+        if (size > 0)
+        {
+            write_chunk("IDAT", m_out.data(), size);
+        }
+    }
+    while (m_zstream.avail_out == 0
+        || (flush == Z_FINISH && status != Z_STREAM_END));
+}
+
+void
+PngStream::write_chunk(char const* type, unsigned char const* data,
+    std::size_t size)
+{
+    unsigned char length[4], crc[4];
+    write_u32(length, static_cast<unsigned long>(size));
+
+    uLong checksum = crc32(0L, reinterpret_cast<Bytef const*>(type), 4);
+    if (size > 0)
+    {
+        checksum = crc32(checksum, data, static_cast<uInt>(size));
+    }
+    write_u32(crc, checksum);
+
+    m_file.write(reinterpret_cast<char const*>(length), 4);
+    m_file.write(type, 4);
+    if (size > 0)
+    {
+        m_file.write(reinterpret_cast<char const*>(data), size);
+    }
+    m_file.write(reinterpret_cast<char const*>(crc), 4);
+}
+
+NpyStream::NpyStream(std::string const& filename, unsigned int width,
+    unsigned int height)
+    : m_filename(filename),
+      m_file(partial_path(filename), std::ofstream::binary), m_width(width),
+      m_height(height), m_rows_written(0), m_finished(false)
+{
+    if (!m_file)
+    {
+        throw std::runtime_error("io error: failed to open " + filename);
+    }
+
+    std::vector<npy::ndarray_len_t> shape = { height, width };
+    npy::header_t header{
+        npy::dtype_map.at(std::type_index(typeid(float))), false, shape };
+    npy::write_header(m_file, header);
+}
+
+NpyStream::~NpyStream()
+{
+    if (!m_finished)
+    {
+        remove_partial(m_file, m_filename);
+    }
+}
+
+void
+NpyStream::write_rows(float const* rows, unsigned int num_rows)
+{
+    num_rows = std::min(num_rows, m_height - m_rows_written);
+
+    m_file.write(reinterpret_cast<char const*>(rows),
+        sizeof(float) * m_width * num_rows);
+
+    m_rows_written += num_rows;
+}
+
+void
+NpyStream::finish()
+{
+    if (m_rows_written < m_height)
+    {
+        throw std::runtime_error("npy error: rows missing in "
+            + m_filename);
+    }
+
+    commit_partial(m_file, m_filename);
+    m_finished = true;
+}
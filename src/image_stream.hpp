@@ -0,0 +1,68 @@
+#ifndef IMAGE_STREAM_HPP
+#define IMAGE_STREAM_HPP
+
+#include <zlib.h>
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Writes an 8 bit PNG image row by row, rows are passed top to bottom and
+// compressed right away so that the whole image never has to be held in
+// memory. The image is written next to the file with the suffix .part and
+// only renamed by finish(), a stream destroyed before removes it again so
+// that no truncated images are left behind.
+class PngStream
+{
+
+public:
+    // Deflate level from 0 to 9, -1 for the default of zlib.
+    PngStream(std::string const& filename, unsigned int width,
+        unsigned int height, unsigned int channels,
+        int level = Z_DEFAULT_COMPRESSION);
+    ~PngStream();
+
+    void write_rows(unsigned char const* rows, unsigned int num_rows);
+
+    // Completes the image once all rows were written and moves it to its
+    // file name.
+    void finish();
+
+private:
+    void deflate_rows(int flush);
+    void write_chunk(char const* type, unsigned char const* data,
+        std::size_t size);
+
+private:
+    std::string m_filename;
+    std::ofstream m_file;
+    z_stream m_zstream;
+    std::vector<unsigned char> m_row, m_out;
+    unsigned int m_width, m_height, m_channels, m_rows_written;
+    bool m_finished;
+};
+
+// Writes a float32 NumPy array of shape (height, width) row by row, rows
+// are passed top to bottom. Like the PNG stream it writes to a .part file
+// renamed by finish().
+class NpyStream
+{
+
+public:
+    NpyStream(std::string const& filename, unsigned int width,
+        unsigned int height);
+    ~NpyStream();
+
+    void write_rows(float const* rows, unsigned int num_rows);
+
+    void finish();
+
+private:
+    std::string m_filename;
+    std::ofstream m_file;
+    unsigned int m_width, m_height, m_rows_written;
+    bool m_finished;
+};
+
+#endif // IMAGE_STREAM_HPP
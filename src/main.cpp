@@ -22,7 +22,9 @@
 #include <memory>
 #include <random>
 #include <regex>
+#include <sstream>
 #include <thread>
+#include <tuple>
 #include <vector>
 
 #include <boost/archive/text_iarchive.hpp>
@@ -38,9 +40,15 @@
 #include <GLviz/utility.hpp>
 #include <nlohmann/json.hpp>
 
+#include "chunk_hierarchy.hpp"
 #include "config.hpp"
 #include "egl.hpp"
+#include "encoder_pool.hpp"
+#include "image_encoder.hpp"
+#include "image_stream.hpp"
 #include "ply_loader.hpp"
+#include "readback.hpp"
+#include "splat_hierarchy.hpp"
 #include "splat_renderer.hpp"
 #include "utils.hpp"
 
@@ -57,7 +65,12 @@ GLviz::Camera g_camera;
 int g_model(1);
 
 std::unique_ptr<SplatRenderer>  viz;
+std::unique_ptr<AsyncReadback>  g_readback;
+FrameStatistics                 g_statistics;
 std::vector<Surfel>             g_surfels;
+ChunkHierarchy                  g_chunks;
+SplatHierarchy                  g_hierarchy;
+bool                            g_lod(false);
 
 void load_triangle_mesh(std::string const& filename, std::vector<
     Eigen::Vector3f>& vertices, std::vector<std::array<
@@ -311,6 +324,9 @@ load_model()
         default:
             load_dragon();
     }
+
+    g_chunks.build(g_surfels);
+    g_hierarchy.build(g_surfels);
 }
 
 void
@@ -602,7 +618,25 @@ mesh_to_surfel(
 void
 display()
 {
-    viz->render_frame(g_surfels);
+    if (g_lod)
+    {
+        viz->render_frame(g_hierarchy);
+    }
+    else
+    {
+        viz->render_frame(g_surfels);
+    }
+
+    // The statistics shown are those of the last frame whose counters
+    // were read back, reading them right away would wait for the GPU.
+    FrameStatistics statistics = viz->queue_statistics();
+    g_readback->read({}, {{viz->counter_buffer(),
+        SplatRenderer::counter_size()}}, 0, 0,
+        [statistics](void const* const* counters)
+        {
+            g_statistics = statistics;
+            SplatRenderer::read_counters(counters[0], g_statistics);
+        });
 }
 
 void
@@ -611,13 +645,22 @@ reshape(int width, int height)
     const float aspect = static_cast<float>(width) /
         static_cast<float>(height);
 
-    glViewport(0, 0, width, height);
+    if (viz)
+    {
+        viz->reshape(width, height);
+    }
+    else
+    {
+        glViewport(0, 0, width, height);
+    }
+
     g_camera.set_perspective(60.0f, aspect, 0.005f, 5.0f);
 }
 
 void
 close_()
 {
+    g_readback = nullptr;
     viz = nullptr;
 }
 
@@ -631,6 +674,14 @@ gui()
     ImGui::PushItemWidth(ImGui::GetContentRegionAvailWidth() * 0.55f);
 
     ImGui::Text("fps \t %.1f fps", ImGui::GetIO().Framerate);
+    ImGui::Text("culled \t %.1f %%",
+        100.0f * g_statistics.culled_fraction());
+    ImGui::Text("occluded \t %.1f %%",
+        100.0f * g_statistics.occluded_fraction());
+    ImGui::Text("footprint \t %.1f px%s",
+        g_statistics.average_footprint,
+        g_statistics.compute_rasterization ? " (compute)" : "");
+    ImGui::Text("gpu \t %.2f ms", viz->gpu_timer().timings().total);
 
     ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
     if (ImGui::CollapsingHeader("Scene"))
@@ -724,10 +775,34 @@ gui()
 
         ImGui::Separator();
 
-        bool multisample_4x = viz->multisample();
-        if (ImGui::Checkbox("Multisample 4x", &multisample_4x))
+        ImGui::Checkbox("Level of detail", &g_lod);
+
+        float lod_tolerance = viz->lod_tolerance();
+        if (ImGui::DragFloat("LOD tolerance",
+            &lod_tolerance, 0.01f, 0.01f, 16.0f))
+        {
+            viz->set_lod_tolerance(std::min(std::max(
+                0.01f, lod_tolerance), 16.0f));
+        }
+
+        ImGui::Separator();
+
+        int samples = 0;
+        while ((2u << samples) <= viz->samples())
         {
-            viz->set_multisample(multisample_4x);
+            ++samples;
+        }
+
+        if (ImGui::Combo("Samples", &samples, "1\0" "2\0" "4\0" "8\0"))
+        {
+            viz->set_samples(1u << samples);
+        }
+
+        float min_sample_shading = viz->min_sample_shading();
+        if (ImGui::DragFloat("Min sample shading",
+            &min_sample_shading, 0.01f, 0.0f, 1.0f))
+        {
+            viz->set_min_sample_shading(min_sample_shading);
         }
 
         bool backface_culling = viz->backface_culling();
@@ -735,6 +810,106 @@ gui()
         {
             viz->set_backface_culling(backface_culling);
         }
+
+        bool quads = viz->quads();
+        if (ImGui::Checkbox("Quads", &quads))
+        {
+            viz->set_quads(quads);
+        }
+
+        bool homography = viz->homography();
+        if (ImGui::Checkbox("Homography", &homography))
+        {
+            viz->set_homography(homography);
+        }
+
+        bool shared_projection = viz->shared_projection();
+        if (ImGui::Checkbox("Shared projection", &shared_projection))
+        {
+            viz->set_shared_projection(shared_projection);
+        }
+
+        bool conservative_depth = viz->conservative_depth();
+        if (ImGui::Checkbox("Conservative depth", &conservative_depth))
+        {
+            viz->set_conservative_depth(conservative_depth);
+        }
+
+        bool gpu_culling = viz->gpu_culling();
+        if (ImGui::Checkbox("GPU culling", &gpu_culling))
+        {
+            viz->set_gpu_culling(gpu_culling);
+        }
+
+        bool front_to_back = viz->front_to_back();
+        if (ImGui::Checkbox("Front to back", &front_to_back))
+        {
+            viz->set_front_to_back(front_to_back);
+        }
+
+        int bin_size = static_cast<int>(viz->bin_size());
+        if (ImGui::DragInt("Bin size", &bin_size, 1.0f, 0, 256))
+        {
+            viz->set_bin_size(static_cast<unsigned int>(
+                std::min(std::max(0, bin_size), 256)));
+        }
+
+        bool hiz_culling = viz->hiz_culling();
+        if (ImGui::Checkbox("Hi-Z culling", &hiz_culling))
+        {
+            viz->set_hiz_culling(hiz_culling);
+        }
+
+        float footprint = viz->compute_rasterization_footprint();
+        if (ImGui::DragFloat("Compute raster footprint",
+            &footprint, 0.1f, 0.0f, 64.0f))
+        {
+            viz->set_compute_rasterization_footprint(std::min(std::max(
+                0.0f, footprint), 64.0f));
+        }
+
+        int hole_filling = static_cast<int>(viz->hole_filling());
+        if (ImGui::DragInt("Hole filling levels", &hole_filling, 0.1f, 0, 8))
+        {
+            viz->set_hole_filling(static_cast<unsigned int>(
+                std::min(std::max(0, hole_filling), 8)));
+        }
+
+        bool pipeline_statistics = viz->pipeline_statistics();
+        if (ImGui::Checkbox("Pipeline statistics", &pipeline_statistics))
+        {
+            viz->set_pipeline_statistics(pipeline_statistics);
+        }
+    }
+
+    if (viz->pipeline_statistics())
+    {
+        ImGui::SetNextTreeNodeOpen(true, ImGuiCond_Once);
+        if (ImGui::CollapsingHeader("Pipeline Statistics"))
+        {
+            FrameStatistics const& statistics = g_statistics;
+
+            PassStatistics const* pass[2] = { &statistics.visibility_pass,
+                &statistics.attribute_pass };
+            char const* name[2] = { "visibility", "attribute" };
+
+            for (unsigned int i(0); i < 2; ++i)
+            {
+                ImGui::Text("%s vertices \t %llu", name[i],
+                    static_cast<unsigned long long>(
+                    pass[i]->vertex_invocations));
+                ImGui::Text("%s primitives \t %llu / %llu", name[i],
+                    static_cast<unsigned long long>(
+                    pass[i]->clipping_output_primitives),
+                    static_cast<unsigned long long>(
+                    pass[i]->clipping_input_primitives));
+                ImGui::Text("%s fragments \t %llu", name[i],
+                    static_cast<unsigned long long>(
+                    pass[i]->fragment_invocations));
+            }
+
+            ImGui::Text("overdraw \t %.2f", statistics.overdraw());
+        }
     }
 
     ImGui::End();
@@ -766,10 +941,15 @@ keyboard(SDL_Keycode key)
 }
 
 int main(int argc, char** argv) {
-  string pcd_path, matrix_path, output_path;
-  bool headless = false, ignore_existing = false;
-  int mp = -1;
-  float max_radius{0.1f};
+  string pcd_path, matrix_path, output_path, format_name{"png"};
+  bool headless = false, ignore_existing = false, gpu_culling = false, hiz_culling = false, pipeline_statistics = false,
+       conservative_depth = false, quads = false, shared_projection = false,
+       homography = false, front_to_back = false;
+  int mp = -1, png_level = -1, png_filter = -1;
+  unsigned int chunk_size = 0, batch = 1, tile_size = 4096, samples = 1, bin_size = 0, benchmark = 0,
+               hole_filling = 0, frames_in_flight = 2, encoder_threads = 4, encoder_memory = 2048,
+               encode_benchmark = 0;
+  float radius_scale{1.2f}, max_radius{0.1f}, lod_tolerance{0.0f}, compute_footprint{0.0f}, min_sample_shading{1.0f};
   CLI::App args{"Surface Splatting Renderer"};
   auto file = args.add_option("-f,--file", pcd_path, "Path to pointcloud to render");
   args.add_option("-m,--matrices", matrix_path, "Path to view matrices json for which to render pointcloud in case of headless rendering.");
@@ -778,6 +958,33 @@ int main(int argc, char** argv) {
   args.add_option("-r,--max_radius", max_radius, "Filter possible outliers in radii file by settings max radius.");
   args.add_flag("-d,--headless", headless, "Run headlessly without a window");
   args.add_flag("-i,--ignore_existing", ignore_existing, "Ignore existing renders and forcefully rewrite them.");
+  args.add_option("-c,--chunk_size", chunk_size, "Surfels per chunk of the culling hierarchy, which draws the surfels in Morton order, 0 keeps the order of the file and disables chunk culling.");
+  args.add_flag("-g,--gpu_culling", gpu_culling, "Cull surfels in a compute shader prepass (OpenGL 4.3).");
+  args.add_option("-l,--lod_tolerance", lod_tolerance, "Draw a level of detail hierarchy with the given screen space error in pixels, 0 draws all surfels.");
+  args.add_flag("-j,--front_to_back", front_to_back, "Draw the chunks of the culling hierarchy front to back, which lets early depth tests reject more hidden fragments, applies along with a chunk size.");
+  args.add_option("-w,--bin_size", bin_size, "Draw the visible surfels of single views sorted by screen bins of this size in pixels, 0 disables binning.");
+  args.add_option("-n,--benchmark", benchmark, "Render every single view this many more times without binning and with bins of 16 to 128 pixels and log the average frame times.");
+  args.add_flag("-z,--hiz_culling", hiz_culling, "Cull occluded surfels against a depth pyramid of a depth prepass (OpenGL 4.3).");
+  args.add_option("-k,--compute_footprint", compute_footprint, "Splat in a compute shader for views whose average splat area in pixels is below this footprint (OpenGL 4.3), 0 disables.");
+  args.add_option("-b,--batch", batch, "Render up to this many views of the same resolution at once into the layers of a texture array, culling does not apply to batches.");
+  args.add_option("-a,--samples", samples, "Samples per pixel of multisample anti-aliasing, 1, 2, 4 or 8, multisampling does not apply to batches.");
+  args.add_option("-x,--min_sample_shading", min_sample_shading, "Minimum fraction of the samples of a pixel to shade when multisampling, 0 shades once per pixel.");
+  args.add_flag("-q,--quads", quads, "Draw splats as quads circumscribing their projection instead of point sprites.");
+  args.add_flag("-y,--homography", homography, "Intersect pixels with splats by a homography per splat set up in the vertex shader.");
+  args.add_flag("-u,--shared_projection", shared_projection, "Project splats once in the depth prepass and reuse the result when drawing them (OpenGL 4.3), applies along with Hi-Z culling.");
+  args.add_flag("-e,--conservative_depth", conservative_depth, "Reject occluded fragments by early depth tests before the ray-splat intersection (OpenGL 4.2).");
+  args.add_flag("-p,--pipeline_statistics", pipeline_statistics, "Log vertex and fragment shader invocations, clipped primitives and overdraw of the passes (OpenGL 4.6 or 4.2 for overdraw only).");
+  args.add_option("--radius_scale", radius_scale, "Scale of the splat radii, enlarged by default to close holes between splats.");
+  args.add_option("--hole_filling", hole_filling, "Fill holes between splats from a pull-push pyramid with this many levels (OpenGL 4.3), allows a radius scale of 1, 0 disables. Not applied to tiled views.");
+  args.add_option("-v,--frames_in_flight", frames_in_flight, "Single views whose readback may still be in flight while the next views render, 0 reads every view back before rendering the next one.");
+  args.add_option("--encoder_threads", encoder_threads, "Threads encoding and writing the output files of single and batched views, 0 writes them on the render thread.");
+  args.add_option("--encoder_memory", encoder_memory, "Megabytes of images waiting for or in encoding at which rendering waits for the encoder threads.");
+  args.add_option("--format", format_name, "Format of the color images and depth previews, png, qoi (lossless, fast) or pam (uncompressed), tiled views are always PNG.")
+      ->check(CLI::IsMember({"png", "qoi", "pam"}));
+  args.add_option("--png_level", png_level, "Deflate level of PNG from 0 (uncompressed) to 9, -1 keeps the default.")->check(CLI::Range(-1, 9));
+  args.add_option("--png_filter", png_filter, "PNG row filter, 0 none, 1 sub, 2 up, 3 average, 4 Paeth, -1 picks one per row.")->check(CLI::Range(-1, 4));
+  args.add_option("--encode_benchmark", encode_benchmark, "Encode the color image of every single view this many times in each format and log the throughput.");
+  args.add_option("-t,--tile_size", tile_size, "Render views larger than this size in tiles streamed into the output files, at most the maximum texture size, 0 tiles views exceeding the maximum texture size only.");
   CLI11_PARSE(args, argc, argv);
 
   if (headless) {
@@ -789,6 +996,12 @@ int main(int argc, char** argv) {
 
       load_ply_to_surfels(pcd_path, max_radius, mp);
       cout << "g_surfels size: " << g_surfels.size() << endl;
+      g_chunks.build(g_surfels, chunk_size);
+      cout << "Chunks: " << g_chunks.num_chunks() << endl;
+      if (lod_tolerance > 0.0f) {
+        g_hierarchy.build(g_surfels);
+        cout << "Hierarchy nodes: " << g_hierarchy.nodes().size() << endl;
+      }
       auto output = filesystem::path(output_path);
 
       if (!matrix_path.empty()) {
@@ -797,42 +1010,66 @@ int main(int argc, char** argv) {
           cout << "Matrices loaded." << endl;
           json j;
           matrices >> j;
-          auto process = [&](
+          struct View {
+            filesystem::path output_file_path, output_depth_path, lock_file_path;
+            std::unique_ptr<boost::interprocess::file_lock> lock;
+            GLviz::Camera camera;
+            GLsizei width, height;
+          };
+          GLint max_texture_size;
+          glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+          auto tile = tile_size > 0 ? std::min((GLsizei)tile_size, (GLsizei)max_texture_size) : (GLsizei)max_texture_size;
+          auto tiled = [&](const View &view) { return view.width > tile || view.height > tile; };
+          // Rows per strip of a tiled view, its color, depth and gray rows of 9 bytes per pixel stay within 256 MB whatever the width.
+          const size_t strip_memory = (size_t)256 << 20;
+          auto strip_rows = [&](GLsizei width) {
+            return std::min(tile, std::max((GLsizei)1, (GLsizei)(strip_memory / (9 * (size_t)width))));
+          };
+          ImageEncoder::Format format;
+          ImageEncoder::parse(format_name, format);
+          ImageEncoder encoder(format);
+          ImageEncoder::set_png_compression(png_level, png_filter);
+          auto prepare = [&](
                   const string &target_render_path,
                   const json &params,
-                  bool ignore_existing) {
+                  bool ignore_existing,
+                  View &view) {
             auto path = filesystem::path(target_render_path);
             auto last_but_one_segment = *(--(--path.end()));
             auto last_segment = *(--path.end());
-            auto output_file_path = output / last_but_one_segment / last_segment;
-            auto output_depth_path = output / last_but_one_segment / std::regex_replace(last_segment.string(), std::regex("_color"), "_depth");
-            auto lock_file_path = output / last_but_one_segment / ("." + last_segment.string() + ".lock");
+            view.output_file_path = output / last_but_one_segment / last_segment;
+            view.output_depth_path = output / last_but_one_segment / std::regex_replace(last_segment.string(), std::regex("_color"), "_depth");
+            view.lock_file_path = output / last_but_one_segment / ("." + last_segment.string() + ".lock");
+            auto camera_matrix = params.at("calibration_mat").get<glm::mat4>();
+            auto image_width = 2.0f * camera_matrix[2][0];
+            auto image_height = 2.0f * camera_matrix[2][1];
+            view.width = (GLsizei)image_width;
+            view.height = (GLsizei)image_height;
+            // Tiles are streamed into PNG files whatever the format.
+            if (!tiled(view)) view.output_file_path.replace_extension(ImageEncoder::extension(format));
             if (!exists(output)) filesystem::create_directory(output);
             if (!exists(output / last_but_one_segment)) filesystem::create_directory(output / last_but_one_segment);
             if (!ignore_existing) {
-              if (filesystem::exists(output_file_path)) {
-                cout << canonical(absolute(output_file_path)) << ": " << "ALREADY EXISTS" << endl;
-                return;
+              if (filesystem::exists(view.output_file_path)) {
+                cout << canonical(absolute(view.output_file_path)) << ": " << "ALREADY EXISTS" << endl;
+                return false;
               }
             }
-            { ofstream{lock_file_path}; }
-            boost::interprocess::file_lock lock(lock_file_path.c_str());
-            if (!lock.try_lock()) {
-              cout << absolute(output_file_path) << ": " << "ALREADY LOCKED" << endl;
-              return;
+            { ofstream{view.lock_file_path}; }
+            view.lock = std::make_unique<boost::interprocess::file_lock>(view.lock_file_path.c_str());
+            if (!view.lock->try_lock()) {
+              cout << absolute(view.output_file_path) << ": " << "ALREADY LOCKED" << endl;
+              return false;
             }
-            cout << absolute(output_file_path) << ": " << "LOCKING" << endl;
+            cout << absolute(view.output_file_path) << ": " << "LOCKING" << endl;
             auto camera_pose = params.at("camera_pose").get<glm::mat4>();
-            auto camera_matrix = params.at("calibration_mat").get<glm::mat4>();
             auto ply_path_for_view = params.value("source_scan_ply_path", pcd_path);
             ply_path_for_view = canonical(absolute(filesystem::path(ply_path_for_view)));
             auto loaded_ply_path = canonical(absolute(filesystem::path(pcd_path)));
             if (ply_path_for_view != loaded_ply_path) {
               cout << "Skipping " << loaded_ply_path << ", rerun with proper ply." << endl;
-              return;
+              return false;
             }
-            auto image_width = 2.0f * camera_matrix[2][0];
-            auto image_height = 2.0f * camera_matrix[2][1];
             auto focal_length_pixels = camera_matrix[0][0];
             assert(focal_length_pixels == camera_matrix[1][1]);
             auto fov = 180.0f * 2.0f * atanf(image_height / (2.0f * focal_length_pixels)) / 3.14159265358979323846f;
@@ -843,32 +1080,316 @@ int main(int argc, char** argv) {
               float(camera_pose[0][1]), float(camera_pose[1][1]), float(camera_pose[2][1]),
               float(camera_pose[0][2]), float(camera_pose[1][2]), float(camera_pose[2][2]);
 
-            glViewport(0, 0, (GLsizei)image_width, (GLsizei)image_height);
-            auto renderer = SplatRenderer(g_camera);
-            renderer.set_color_material(false);
-            renderer.set_multisample(false);
-            renderer.set_pointsize_method(1);  // Amended BHZK05
-            renderer.set_backface_culling(true);
-            renderer.set_soft_zbuffer(false);
-            renderer.set_radius_scale(1.2);
-            renderer.framebuffer().enable_depth_texture();
-
-            g_camera.set_orientation(cam_pose_eigen);
-            g_camera.set_position(Vector3f(camera_pose[3][0], camera_pose[3][1], camera_pose[3][2]));
-            g_camera.set_perspective(fov, image_width / image_height, 0.1f, 100.0f);
-
-            auto start = high_resolution_clock::now();
-            renderer.render_frame(g_surfels);
-            auto end = high_resolution_clock::now();
-
-            save_png(renderer.framebuffer().color_texture(), output_file_path.c_str());
-            auto proj = g_camera.get_projection_matrix();
-            save_depth(renderer.framebuffer().depth_texture(), output_depth_path.c_str(), proj(2, 2), proj(2, 3));
-
-            cout << canonical(absolute(output_file_path)) << ": " << (float)duration_cast<milliseconds>(end - start).count() / 1000.0f << " s" << endl;
+            view.camera.set_orientation(cam_pose_eigen);
+            view.camera.set_position(Vector3f(camera_pose[3][0], camera_pose[3][1], camera_pose[3][2]));
+            view.camera.set_perspective(fov, image_width / image_height, 0.1f, 100.0f);
+            return true;
+          };
+          // A single renderer serves all views, it switches between pooled framebuffers as the resolution changes.
+          auto renderer = SplatRenderer(g_camera);
+          renderer.set_color_material(false);
+          renderer.set_samples(samples);
+          renderer.set_min_sample_shading(min_sample_shading);
+          renderer.set_pointsize_method(1);  // Amended BHZK05
+          renderer.set_backface_culling(true);
+          renderer.set_soft_zbuffer(false);
+          renderer.set_radius_scale(radius_scale);
+          renderer.set_hole_filling(hole_filling);
+          renderer.set_gpu_culling(gpu_culling);
+          renderer.set_hiz_culling(hiz_culling);
+          renderer.set_bin_size(bin_size);
+          renderer.set_front_to_back(front_to_back);
+          renderer.set_lod_tolerance(lod_tolerance);
+          renderer.set_compute_rasterization_footprint(compute_footprint);
+          renderer.set_pipeline_statistics(pipeline_statistics);
+          renderer.set_conservative_depth(conservative_depth);
+          renderer.set_quads(quads);
+          renderer.set_shared_projection(shared_projection);
+          renderer.set_homography(homography);
+          renderer.set_chunk_hierarchy(&g_chunks);
+          renderer.framebuffer().enable_depth_texture();
+          // Output files are encoded and written by threads of their own, the render thread only waits for them at the memory cap.
+          EncoderPool encoders(encoder_threads, (size_t)encoder_memory << 20);
+          // Single views are read back while the next ones render, 0 frames in flight reads them synchronously.
+          AsyncReadback readback(frames_in_flight);
+          // GPU times of the given frame, waiting for the queries after its readback. Left out if the timer already reused the queries of
+          // the frame, i.e. with more frames in flight than the timer keeps.
+          auto gpu_log = [&](std::uint64_t frame) {
+            auto timings = renderer.gpu_timer().timings(frame);
+            std::ostringstream log;
+            if (!timings) return log.str();
+            log << ", gpu " << timings->total << " ms (";
+            auto first = true;
+            for (unsigned int i = 0; i < GpuTimer::num_passes; ++i) {
+              if (timings->pass[i] < 0.0) continue;
+              log << (first ? "" : ", ") << GpuTimer::name(static_cast<GpuTimer::Pass>(i)) << " " << timings->pass[i];
+              first = false;
+            }
+            log << ")";
+            return log.str();
+          };
+          // Pipeline statistics of a frame, passes that did not run are left out.
+          auto statistics_log = [&](const FrameStatistics &statistics) {
+            std::ostringstream log;
+            if (!renderer.pipeline_statistics()) return log.str();
+            auto log_pass = [&](const char *name, const PassStatistics &pass) {
+              if (pass.vertex_invocations == 0) return;
+              log << ", " << name << " " << pass.vertex_invocations << " vertices " << pass.clipping_output_primitives << "/"
+                  << pass.clipping_input_primitives << " primitives " << pass.fragment_invocations << " fragments";
+            };
+            log_pass("visibility", statistics.visibility_pass);
+            log_pass("attribute", statistics.attribute_pass);
+            log << ", overdraw " << statistics.overdraw();
+            return log.str();
+          };
+          // Average time of a frame including its GPU work without screen binning and for a range of bin sizes, one frame per size warms up.
+          auto benchmark_log = [&]() {
+            auto render = [&]() {
+              if (lod_tolerance > 0.0f)
+                renderer.render_frame(g_hierarchy);
+              else
+                renderer.render_frame(g_surfels);
+              renderer.gpu_timer().end_frame();
+            };
+            std::ostringstream log;
+            auto configured = renderer.bin_size();
+            for (unsigned int size : {0u, 16u, 32u, 64u, 128u}) {
+              renderer.set_bin_size(size);
+              render();
+              glFinish();
+              auto start = high_resolution_clock::now();
+              for (unsigned int i = 0; i < benchmark; ++i) render();
+              glFinish();
+              auto end = high_resolution_clock::now();
+              log << (size == 0 ? ", unbinned " : ", bin " + std::to_string(size) + " ")
+                  << (float)duration_cast<microseconds>(end - start).count() / 1000.0f / benchmark << " ms";
+            }
+            renderer.set_bin_size(configured);
+            return log.str();
+          };
+          // Encoding throughput of a color image in MB/s of 8 bit RGBA and the encoded size relative to it, PNG at a few levels.
+          auto encode_benchmark_log = [&](const unsigned char *rgba8, GLsizei width, GLsizei height) {
+            // Encoder threads would compete for the cores and the PNG level is global.
+            encoders.finish();
+            auto size = (size_t)4 * width * height;
+            auto megabytes = size / 1.0e6f;
+            std::vector<unsigned char> data;
+            std::ostringstream log;
+            auto measure = [&](const ImageEncoder &encoder, const std::string &name) {
+              auto start = high_resolution_clock::now();
+              for (unsigned int i = 0; i < encode_benchmark; ++i)
+                encoder.encode(rgba8, width, height, 4, data);
+              auto end = high_resolution_clock::now();
+              auto seconds = (float)duration_cast<microseconds>(end - start).count() / 1.0e6f;
+              log << ", " << name << " " << megabytes * encode_benchmark / seconds << " MB/s "
+                  << 100.0f * data.size() / size << " %";
+            };
+            for (int level : {1, 4, 8}) {
+              ImageEncoder::set_png_compression(level, png_filter);
+              measure(ImageEncoder(ImageEncoder::png), "png " + std::to_string(level));
+            }
+            ImageEncoder::set_png_compression(png_level, png_filter);
+            measure(ImageEncoder(ImageEncoder::qoi), "qoi");
+            measure(ImageEncoder(ImageEncoder::pam), "pam");
+            return log.str();
+          };
+          // Renders views of the same resolution, more than one are rendered at once into the layers of the framebuffer.
+          auto render_batch = [&](std::vector<View> &views) {
+            if (views.empty()) return;
+            if (tiled(views.front()))
+              renderer.reshape(tile, strip_rows(views.front().width));
+            else
+              renderer.reshape(views.front().width, views.front().height);
+
+            if (tiled(views.front())) {
+              auto &view = views.front();
+              g_camera = view.camera;
+              auto proj = g_camera.get_projection_matrix();
+              auto width = view.width, height = view.height;
+              auto strip = strip_rows(width);
+              PngStream color_png(view.output_file_path.string(), width, height, 4, png_level);
+              PngStream depth_png(view.output_depth_path.string(), width, height, 1, png_level);
+              NpyStream depth_npy(view.output_depth_path.string() + ".npy", width, height);
+
+              // Rows of tiles are rendered top to bottom, only a single strip of the image is held in memory.
+              auto start = high_resolution_clock::now();
+              for (GLsizei top = 0; top < height; top += strip) {
+                auto rows = std::min(strip, height - top);
+                auto color_strip = std::vector<unsigned char>(4 * (size_t)width * rows);
+                auto depth_strip = std::vector<float>((size_t)width * rows);
+                auto gray_strip = std::vector<uint8_t>((size_t)width * rows);
+                for (GLsizei left = 0; left < width; left += tile) {
+                  // Lower left corner of the tile in window coordinates of the image, tiles at the border reach beyond it.
+                  renderer.set_tile(left, height - top - strip, width, height);
+                  if (lod_tolerance > 0.0f)
+                    renderer.render_frame(g_hierarchy);
+                  else
+                    renderer.render_frame(g_surfels);
+
+                  renderer.gpu_timer().begin(GpuTimer::readback_pass);
+                  auto &fbo = renderer.framebuffer().resolve();
+                  auto colors = read_texture(fbo.color_texture(), GL_RGBA, 4);
+                  auto depths = read_texture(fbo.depth_texture(), GL_DEPTH_COMPONENT, 1);
+                  renderer.gpu_timer().end(GpuTimer::readback_pass);
+                  renderer.gpu_timer().end_frame();
+                  auto columns = std::min(tile, width - left);
+                  for (GLsizei r = 0; r < rows; ++r) {
+                    auto src = (size_t)(strip - 1 - r) * tile;  // OpenGL rows are bottom-up.
+                    auto dst = (size_t)r * width + left;
+                    for (GLsizei c = 0; c < columns; ++c) {
+                      for (int k = 0; k < 4; ++k)
+                        color_strip[4 * (dst + c) + k] = (unsigned char)(colors[4 * (src + c) + k] * 255.0f);
+                      depth_strip[dst + c] = linearize_depth(depths[src + c], proj(2, 2), proj(2, 3));
+                      gray_strip[dst + c] = depth_to_gray(depth_strip[dst + c]);
+                    }
+                  }
+                }
+                color_png.write_rows(color_strip.data(), rows);
+                depth_png.write_rows(gray_strip.data(), rows);
+                depth_npy.write_rows(depth_strip.data(), rows);
+              }
+              // Only complete files replace their .part files, a failed tile leaves no truncated image behind.
+              color_png.finish();
+              depth_png.finish();
+              depth_npy.finish();
+              renderer.reset_tile();
+              auto end = high_resolution_clock::now();
+
+              cout << canonical(absolute(view.output_file_path)) << ": " << (float)duration_cast<milliseconds>(end - start).count() / 1000.0f << " s"
+                   << " (" << (width + tile - 1) / tile << "x" << (height + strip - 1) / strip << " tiles)" << gpu_log(renderer.gpu_timer().frame()) << endl;
+            }
+            else if (views.size() == 1) {
+              g_camera = views.front().camera;
+
+              auto start = high_resolution_clock::now();
+              if (lod_tolerance > 0.0f)
+                renderer.render_frame(g_hierarchy);
+              else
+                renderer.render_frame(g_surfels);
+              auto end = high_resolution_clock::now();
+              // Counts of the GPU passes are read back along with the images, reading them now would wait for the GPU.
+              auto statistics = renderer.queue_statistics();
+              auto seconds = (float)duration_cast<milliseconds>(end - start).count() / 1000.0f;
+              auto frame = renderer.gpu_timer().frame();
+              auto gpu_line = std::make_shared<std::string>();
+
+              // The view is released once its images are written, which with reads in flight happens during a later view.
+              auto view = std::make_shared<View>(std::move(views.front()));
+              auto log = std::make_shared<std::string>(), benchmark_line = std::make_shared<std::string>();
+              // An encoder thread takes over the images, the log lines are complete by the time it runs.
+              auto write = [&, view, log, benchmark_line](std::vector<unsigned char> colors, std::vector<float> depths,
+                                                          std::vector<uint8_t> previews) {
+                if (encode_benchmark > 0) {
+                  if (benchmark_line->empty())
+                    *benchmark_line = ": " + std::to_string(view->width) + "x" + std::to_string(view->height);
+                  *benchmark_line += encode_benchmark_log(colors.data(), view->width, view->height);
+                }
+                auto bytes = colors.size() + sizeof(float) * depths.size() + previews.size();
+                auto images = std::make_shared<std::tuple<std::vector<unsigned char>, std::vector<float>, std::vector<uint8_t>>>(
+                        std::move(colors), std::move(depths), std::move(previews));
+                encoders.submit([view, log, benchmark_line, images, encoder]() {
+                  auto &[colors, depths, previews] = *images;
+                  encoder.write(view->output_file_path.string(), colors.data(), view->width, view->height, 4);  // 4=RGBA
+                  write_depth(depths.data(), previews.data(), view->width, view->height, view->output_depth_path.c_str(), encoder);
+                  auto path = canonical(absolute(view->output_file_path)).string();
+                  cout << (path + *log + "\n" + (benchmark_line->empty() ? "" : path + *benchmark_line + "\n")) << flush;
+                  view->lock->unlock();
+                  remove(view->lock_file_path);
+                }, bytes);
+              };
+              auto pixels = (size_t)view->width * view->height;
+              auto copy = [&, write, pixels, log, statistics, seconds, frame, gpu_line](const void *const *images) {
+                auto colors = (const unsigned char *)images[0];
+                auto depths = (const float *)images[1];
+                auto previews = (const uint8_t *)images[2];
+                auto frame_statistics = statistics;
+                SplatRenderer::read_counters(images[3], frame_statistics);
+                std::ostringstream line;
+                line << ": " << seconds << " s"
+                     << ", culled " << 100.0f * frame_statistics.culled_fraction() << " %"
+                     << ", occluded " << 100.0f * frame_statistics.occluded_fraction() << " %"
+                     << ", footprint " << frame_statistics.average_footprint << " px"
+                     << (frame_statistics.compute_rasterization ? " (compute)" : "") << statistics_log(frame_statistics)
+                     << (gpu_line->empty() ? gpu_log(frame) : *gpu_line);
+                *log = line.str();
+                write(std::vector<unsigned char>(colors, colors + 4 * pixels), std::vector<float>(depths, depths + pixels),
+                      std::vector<uint8_t>(previews, previews + pixels));
+              };
+              // Encoding stays out of the readback pass. The output pass converts color and linearizes depth into top-down
+              // rows on the GPU already, all outputs and the counters of the statistics are read back in a single buffer.
+              renderer.gpu_timer().begin(GpuTimer::readback_pass);
+              auto &output = renderer.render_output(renderer.framebuffer().resolve());
+              readback.read({{output.color, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, 4}, {output.depth, GL_RED, GL_FLOAT, 4},
+                             {output.preview, GL_RED_INTEGER, GL_UNSIGNED_BYTE, 1}},
+                            {{renderer.counter_buffer(), SplatRenderer::counter_size()}}, view->width, view->height, copy);
+              renderer.gpu_timer().end(GpuTimer::readback_pass);
+              renderer.gpu_timer().end_frame();
+
+              if (benchmark > 0) {
+                // The benchmark frames reuse the timer queries of the view before its readback completes, they wait for the GPU anyway.
+                *gpu_line = gpu_log(frame);
+                *benchmark_line = ": " + std::to_string(view->width) + "x" + std::to_string(view->height) + benchmark_log();
+              }
+              if (frames_in_flight == 0)
+                readback.finish();
+            }
+            else {
+              std::vector<GLviz::Camera> cameras;
+              for (auto &view: views) cameras.push_back(view.camera);
+
+              auto start = high_resolution_clock::now();
+              renderer.render_frame(g_surfels, cameras);
+              auto end = high_resolution_clock::now();
+
+              renderer.gpu_timer().begin(GpuTimer::readback_pass);
+              auto colors = std::make_shared<std::vector<float>>(read_texture_array(renderer.framebuffer().color_texture(), GL_RGBA, 4));
+              auto depths = std::make_shared<std::vector<float>>(read_texture_array(renderer.framebuffer().depth_texture(), GL_DEPTH_COMPONENT, 1));
+              renderer.gpu_timer().end(GpuTimer::readback_pass);
+              renderer.gpu_timer().end_frame();
+              // The views of the batch share the images, each one accounts for its layers.
+              auto pixels = (size_t)views.front().width * views.front().height;
+              for (size_t i = 0; i < views.size(); ++i) {
+                auto view = std::make_shared<View>(std::move(views[i]));
+                auto proj = view->camera.get_projection_matrix();
+                std::ostringstream line;
+                line << ": " << (float)duration_cast<milliseconds>(end - start).count() / 1000.0f / views.size() << " s"
+                     << " (batch of " << views.size() << ")" << statistics_log(renderer.statistics()) << gpu_log(renderer.gpu_timer().frame()) << "\n";
+                encoders.submit([view, proj, colors, depths, pixels, i, encoder, log = line.str()]() {
+                  write_color(colors->data() + 4 * pixels * i, view->width, view->height, view->output_file_path.c_str(), encoder);
+                  write_depth(depths->data() + pixels * i, view->width, view->height, view->output_depth_path.c_str(), proj(2, 2), proj(2, 3), encoder);
+                  cout << (canonical(absolute(view->output_file_path)).string() + log) << flush;
+                  view->lock->unlock();
+                  remove(view->lock_file_path);
+                }, 5 * sizeof(float) * pixels);
+              }
+            }
 
-            lock.unlock();
-            remove(lock_file_path);
+            for (auto &view: views) {
+              if (!view.lock) continue;  // Handed over to the readback or an encoder.
+              view.lock->unlock();
+              remove(view.lock_file_path);
+            }
+            views.clear();
+          };
+          if (batch > SplatRenderer::max_views) {
+            cout << "Batch size limited to " << SplatRenderer::max_views << " views." << endl;
+            batch = SplatRenderer::max_views;
+          }
+          if (batch > 1 && lod_tolerance > 0.0f) {
+            cout << "Level of detail renders single views, batching is disabled." << endl;
+            batch = 1;
+          }
+          std::vector<View> views;
+          auto process = [&](
+                  const string &target_render_path,
+                  const json &params,
+                  bool ignore_existing) {
+            View view;
+            if (!prepare(target_render_path, params, ignore_existing, view)) return;
+            if (!views.empty() && (views.front().width != view.width || views.front().height != view.height))
+              render_batch(views);
+            views.push_back(std::move(view));
+            if (views.size() >= std::max(batch, 1u) || tiled(views.front())) render_batch(views);
           };
           for (auto &[target_render_path, params]: j.at("train").items()) {
             process(target_render_path, params, ignore_existing);
@@ -876,6 +1397,9 @@ int main(int argc, char** argv) {
           for (auto &[target_render_path, params]: j.at("val").items()) {
             process(target_render_path, params, ignore_existing);
           }
+          render_batch(views);
+          readback.finish();
+          encoders.finish();
         }
         else {
           cout << "Error opening matrix file" << endl;
@@ -897,6 +1421,8 @@ int main(int argc, char** argv) {
 
     g_camera.translate(Eigen::Vector3f(0.0f, 0.0f, -2.0f));
     viz = std::unique_ptr<SplatRenderer>(new SplatRenderer(g_camera));
+    viz->set_chunk_hierarchy(&g_chunks);
+    g_readback = std::unique_ptr<AsyncReadback>(new AsyncReadback(3));
 
     load_model();
 
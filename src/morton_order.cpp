@@ -0,0 +1,70 @@
+#include "morton_order.hpp"
+
+#include "splat_renderer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+using namespace Eigen;
+
+namespace
+{
+
+// Spreads the lower 10 bits of x such that there are two zero bits
+// between each of them.
+std::uint32_t
+expand_bits(std::uint32_t x)
+{
+    x = (x | (x << 16)) & 0x030000ffu;
+    x = (x | (x << 8)) & 0x0300f00fu;
+    x = (x | (x << 4)) & 0x030c30c3u;
+    x = (x | (x << 2)) & 0x09249249u;
+    return x;
+}
+
+std::uint32_t
+morton_code(Vector3f const& p)
+{
+    Vector3f q = (1023.0f * p).cwiseMax(0.0f).cwiseMin(1023.0f);
+    return (expand_bits(static_cast<std::uint32_t>(q.x())) << 2)
+        | (expand_bits(static_cast<std::uint32_t>(q.y())) << 1)
+        | expand_bits(static_cast<std::uint32_t>(q.z()));
+}
+
+}
+
+void
+sort_morton(std::vector<Surfel>& surfels)
+{
+    if (surfels.empty())
+    {
+        return;
+    }
+
+    Vector3f box_min = surfels.front().c, box_max = surfels.front().c;
+    for (Surfel const& s : surfels)
+    {
+        box_min = box_min.cwiseMin(s.c);
+        box_max = box_max.cwiseMax(s.c);
+    }
+
+    float extent = std::max((box_max - box_min).maxCoeff(), 1e-12f);
+
+    std::vector<std::pair<std::uint32_t, unsigned int>> keys(surfels.size());
+    for (unsigned int i(0); i < keys.size(); ++i)
+    {
+        keys[i] = std::make_pair(
+            morton_code((surfels[i].c - box_min) / extent), i);
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<Surfel> sorted(surfels.size());
+    for (unsigned int i(0); i < keys.size(); ++i)
+    {
+        sorted[i] = surfels[keys[i].second];
+    }
+
+    surfels.swap(sorted);
+}
@@ -0,0 +1,12 @@
+#ifndef MORTON_ORDER_HPP
+#define MORTON_ORDER_HPP
+
+#include <vector>
+
+struct Surfel;
+
+// Sorts the surfels along a Morton curve through their bounding box, i.e.
+// spatially close surfels end up close to each other in the vector.
+void sort_morton(std::vector<Surfel>& surfels);
+
+#endif // MORTON_ORDER_HPP
@@ -21,13 +21,16 @@
 #include <cstddef>
 
 extern unsigned char const attribute_vs_glsl[];
+extern unsigned char const attribute_gs_glsl[];
 extern unsigned char const attribute_fs_glsl[];
 extern unsigned char const lighting_glsl[];
 
 ProgramAttribute::ProgramAttribute()
     : m_ewa_filter(false), m_backface_culling(false),
       m_visibility_pass(true), m_smooth(false), m_color_material(false),
-      m_pointsize_method(0)
+      m_lod(false), m_multiview(false), m_overdraw(false),
+      m_conservative_depth(false), m_quads(false), m_capture(false),
+      m_captured(false), m_homography(false), m_pointsize_method(0)
 {
     initialize_shader_obj();
     initialize_program_obj();
@@ -93,6 +96,86 @@ ProgramAttribute::set_color_material(bool enable)
     }
 }
 
+void
+ProgramAttribute::set_lod(bool enable)
+{
+    if (m_lod != enable)
+    {
+        m_lod = enable;
+        initialize_program_obj();
+    }
+}
+
+void
+ProgramAttribute::set_multiview(bool enable)
+{
+    if (m_multiview != enable)
+    {
+        m_multiview = enable;
+        initialize_program_obj();
+    }
+}
+
+void
+ProgramAttribute::set_overdraw(bool enable)
+{
+    if (m_overdraw != enable)
+    {
+        m_overdraw = enable;
+        initialize_program_obj();
+    }
+}
+
+void
+ProgramAttribute::set_conservative_depth(bool enable)
+{
+    if (m_conservative_depth != enable)
+    {
+        m_conservative_depth = enable;
+        initialize_program_obj();
+    }
+}
+
+void
+ProgramAttribute::set_quads(bool enable)
+{
+    if (m_quads != enable)
+    {
+        m_quads = enable;
+        initialize_program_obj();
+    }
+}
+
+void
+ProgramAttribute::set_capture(bool enable)
+{
+    if (m_capture != enable)
+    {
+        m_capture = enable;
+        initialize_program_obj();
+    }
+}
+
+void
+ProgramAttribute::set_captured(bool enable)
+{
+    if (m_captured != enable)
+    {
+        m_captured = enable;
+        initialize_program_obj();
+    }
+}
+
+void
+ProgramAttribute::set_homography(bool enable)
+{
+    if (m_homography != enable)
+    {
+        m_homography = enable;
+        initialize_program_obj();
+    }
+}
+
 void
 ProgramAttribute::initialize_shader_obj()
 {
@@ -101,6 +184,9 @@ ProgramAttribute::initialize_shader_obj()
     m_lighting_vs_obj.load_from_cstr(
         reinterpret_cast<char const*>(lighting_glsl));
 
+    m_attribute_gs_obj.load_from_cstr(
+        reinterpret_cast<char const*>(attribute_gs_glsl));
+
     m_attribute_fs_obj.load_from_cstr(
         reinterpret_cast<char const*>(attribute_fs_glsl));
 }
@@ -116,6 +202,14 @@ ProgramAttribute::initialize_program_obj()
         attach_shader(m_attribute_fs_obj);
         attach_shader(m_lighting_vs_obj);
 
+        bool quads = m_quads && (m_visibility_pass || !m_ewa_filter);
+        bool geometry_shader = m_multiview || quads;
+
+        if (geometry_shader)
+        {
+            attach_shader(m_attribute_gs_obj);
+        }
+
         std::map<std::string, int> defines;
         
         defines.insert(std::make_pair("EWA_FILTER",
@@ -130,10 +224,31 @@ ProgramAttribute::initialize_program_obj()
             m_smooth ? 1 : 0));
         defines.insert(std::make_pair("COLOR_MATERIAL",
             m_color_material ? 1 : 0));
+        defines.insert(std::make_pair("LOD",
+            m_lod ? 1 : 0));
+        defines.insert(std::make_pair("MULTIVIEW",
+            m_multiview ? 1 : 0));
+        defines.insert(std::make_pair("OVERDRAW",
+            m_overdraw ? 1 : 0));
+        defines.insert(std::make_pair("CONSERVATIVE_DEPTH",
+            m_conservative_depth ? 1 : 0));
+        defines.insert(std::make_pair("QUADS",
+            quads ? 1 : 0));
+        defines.insert(std::make_pair("CAPTURE",
+            m_capture ? 1 : 0));
+        defines.insert(std::make_pair("CAPTURED",
+            m_captured ? 1 : 0));
+        defines.insert(std::make_pair("HOMOGRAPHY",
+            m_homography ? 1 : 0));
 
         m_attribute_vs_obj.compile(defines);
         m_attribute_fs_obj.compile(defines);
         m_lighting_vs_obj.compile(defines);
+
+        if (geometry_shader)
+        {
+            m_attribute_gs_obj.compile(defines);
+        }
     }
     catch (shader_compilation_error const& e)
     {
@@ -159,6 +274,11 @@ ProgramAttribute::initialize_program_obj()
         set_uniform_block_binding("Raycast", 1);
         set_uniform_block_binding("Frustum", 2);
         set_uniform_block_binding("Parameter", 3);
+
+        if (m_multiview)
+        {
+            set_uniform_block_binding("Views", 4);
+        }
     }
     catch (uniform_not_found_error const& e)
     {
@@ -32,6 +32,37 @@ public:
     void set_visibility_pass(bool enable = true);
     void set_smooth(bool enable = true);
     void set_color_material(bool enable = true);
+    void set_lod(bool enable = true);
+
+    // Draws one instance per view of the Views block into the layer of the
+    // framebuffer given by the instance.
+    void set_multiview(bool enable = true);
+
+    // Counts the fragments inside of the splats in the atomic counter
+    // buffer bound to binding point 0, requires atomic counters.
+    void set_overdraw(bool enable = true);
+
+    // Declares the written depth as never less than the depth of the point
+    // sprite, which allows early depth tests. Requires conservative depth.
+    void set_conservative_depth(bool enable = true);
+
+    // Expands splats into quads circumscribing their projection in a
+    // geometry shader instead of drawing point sprites. The EWA filter
+    // reaches beyond the splat and keeps drawing point sprites.
+    void set_quads(bool enable = true);
+
+    // Writes the projection of every splat to the storage buffer bound to
+    // binding point 0, or reads it from there instead of transforming and
+    // bounding the splats anew. Requires storage buffers in the vertex
+    // shader, multi-view draws take the number of splats per view from the
+    // num_pts uniform.
+    void set_capture(bool enable = true);
+    void set_captured(bool enable = true);
+
+    // Maps window coordinates to splat coordinates and depth by a
+    // homography per splat set up in the vertex shader instead of
+    // intersecting the view ray of every fragment with the splat.
+    void set_homography(bool enable = true);
 
 private:
     void initialize_shader_obj();
@@ -39,10 +70,13 @@ private:
 
 private:
     glVertexShader m_attribute_vs_obj, m_lighting_vs_obj;
+    glGeometryShader m_attribute_gs_obj;
     glFragmentShader m_attribute_fs_obj;
 
     bool m_ewa_filter, m_backface_culling,
-         m_visibility_pass, m_smooth, m_color_material;
+         m_visibility_pass, m_smooth, m_color_material, m_lod,
+         m_multiview, m_overdraw, m_conservative_depth, m_quads,
+         m_capture, m_captured, m_homography;
     unsigned int m_pointsize_method;
 };
 
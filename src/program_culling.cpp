@@ -0,0 +1,79 @@
+#include "program_culling.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+extern unsigned char const culling_cs_glsl[];
+
+ProgramCulling::ProgramCulling(bool occlusion, Input input)
+    : m_backface_culling(false), m_occlusion(occlusion), m_input(input)
+{
+    initialize_shader_obj();
+    initialize_program_obj();
+}
+
+void
+ProgramCulling::set_backface_culling(bool enable)
+{
+    if (m_backface_culling != enable)
+    {
+        m_backface_culling = enable;
+        initialize_program_obj();
+    }
+}
+
+void
+ProgramCulling::initialize_shader_obj()
+{
+    m_culling_cs_obj.load_from_cstr(
+        reinterpret_cast<char const*>(culling_cs_glsl));
+
+    attach_shader(m_culling_cs_obj);
+}
+
+void
+ProgramCulling::initialize_program_obj()
+{
+    try
+    {
+        std::map<std::string, int> defines;
+        defines.insert(std::make_pair("BACKFACE_CULLING",
+            m_backface_culling ? 1 : 0));
+        defines.insert(std::make_pair("HIZ", m_occlusion ? 1 : 0));
+        defines.insert(std::make_pair("INPUT", static_cast<int>(m_input)));
+        defines.insert(std::make_pair("WORK_GROUP_SIZE",
+            static_cast<int>(work_group_size)));
+
+        m_culling_cs_obj.compile(defines);
+    }
+    catch (shader_compilation_error const& e)
+    {
+        std::cerr << "Error: A shader failed to compile." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        link();
+    }
+    catch (shader_link_error const& e)
+    {
+        std::cerr << "Error: A program failed to link." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        set_uniform_block_binding("Camera", 0);
+        set_uniform_block_binding("Raycast", 1);
+        set_uniform_block_binding("Frustum", 2);
+        set_uniform_block_binding("Parameter", 3);
+    }
+    catch (uniform_not_found_error const& e)
+    {
+        std::cerr << "Warning: Failed to set a uniform variable." << std::endl
+            << e.what() << std::endl;
+    }
+}
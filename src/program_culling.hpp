@@ -0,0 +1,44 @@
+#ifndef PROGRAM_CULLING_HPP
+#define PROGRAM_CULLING_HPP
+
+#include "compute_shader.hpp"
+
+#include <GLviz/program.hpp>
+
+// Compute prepass which frustum and backface culls the surfels and writes
+// the indices of the remaining ones together with a DrawElementsIndirect
+// command consumed by the visibility and attribute passes. The occlusion
+// variant additionally tests the screen bounds of every surfel against a
+// Hi-Z pyramid bound to the sampler uniform hiz.
+class ProgramCulling : public glProgram
+{
+
+public:
+    // Surfels the pass runs over: all of them, a list of surfel indices
+    // that passed frustum culling already or a list of chunks whose bounds
+    // are tested against the pyramid before their surfels, the latter for
+    // the occlusion variant only.
+    enum Input
+    {
+        all_surfels, surfel_list, chunk_list, num_inputs
+    };
+
+    explicit ProgramCulling(bool occlusion = false,
+        Input input = all_surfels);
+
+    void set_backface_culling(bool enable = true);
+
+    static unsigned int const work_group_size = 256;
+
+private:
+    void initialize_shader_obj();
+    void initialize_program_obj();
+
+private:
+    ComputeShader m_culling_cs_obj;
+
+    bool m_backface_culling, m_occlusion;
+    Input m_input;
+};
+
+#endif // PROGRAM_CULLING_HPP
@@ -0,0 +1,23 @@
+#ifndef PROGRAM_DEPTH_RESOLVE_HPP
+#define PROGRAM_DEPTH_RESOLVE_HPP
+
+#include <GLviz/program.hpp>
+
+// Copies the depth splatted by the compute rasterizer into the depth
+// attachment of the framebuffer.
+class ProgramDepthResolve : public glProgram
+{
+
+public:
+    ProgramDepthResolve();
+
+private:
+    void initialize_shader_obj();
+    void initialize_program_obj();
+
+private:
+    glVertexShader    m_finalization_vs_obj;
+    glFragmentShader  m_depth_resolve_fs_obj;
+};
+
+#endif // PROGRAM_DEPTH_RESOLVE_HPP
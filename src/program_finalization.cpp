@@ -21,11 +21,13 @@
 #include <cstdlib>
 
 extern unsigned char const finalization_vs_glsl[];
+extern unsigned char const finalization_gs_glsl[];
 extern unsigned char const finalization_fs_glsl[];
 extern unsigned char const lighting_glsl[];
 
 ProgramFinalization::ProgramFinalization()
-    : m_smooth(false), m_multisampling(false)
+    : m_smooth(false), m_multisampling(false), m_multiview(false),
+      m_samples(4)
 {
     initialize_shader_obj();
     initialize_program_obj();
@@ -41,6 +43,16 @@ ProgramFinalization::set_multisampling(bool enable)
     }
 }
 
+void
+ProgramFinalization::set_samples(unsigned int samples)
+{
+    if (m_samples != samples)
+    {
+        m_samples = samples;
+        initialize_program_obj();
+    }
+}
+
 void
 ProgramFinalization::set_smooth(bool enable)
 {
@@ -51,19 +63,27 @@ ProgramFinalization::set_smooth(bool enable)
     }
 }
 
+void
+ProgramFinalization::set_multiview(bool enable)
+{
+    if (m_multiview != enable)
+    {
+        m_multiview = enable;
+        initialize_program_obj();
+    }
+}
+
 void
 ProgramFinalization::initialize_shader_obj()
 {
     m_finalization_vs_obj.load_from_cstr(
         reinterpret_cast<char const*>(finalization_vs_glsl));
+    m_finalization_gs_obj.load_from_cstr(
+        reinterpret_cast<char const*>(finalization_gs_glsl));
     m_finalization_fs_obj.load_from_cstr(
         reinterpret_cast<char const*>(finalization_fs_glsl));
     m_lighting_fs_obj.load_from_cstr(
         reinterpret_cast<char const*>(lighting_glsl));
-
-    attach_shader(m_finalization_vs_obj);
-    attach_shader(m_finalization_fs_obj);
-    attach_shader(m_lighting_fs_obj);
 }
 
 void
@@ -71,14 +91,34 @@ ProgramFinalization::initialize_program_obj()
 {
     try
     {
+        detach_all();
+
+        attach_shader(m_finalization_vs_obj);
+        attach_shader(m_finalization_fs_obj);
+        attach_shader(m_lighting_fs_obj);
+
+        if (m_multiview)
+        {
+            attach_shader(m_finalization_gs_obj);
+        }
+
         std::map<std::string, int> defines;
         defines.insert(std::make_pair("SMOOTH", m_smooth ? 1 : 0));
         defines.insert(std::make_pair("MULTISAMPLING",
             m_multisampling ? 1 : 0));
+        defines.insert(std::make_pair("MULTIVIEW",
+            m_multiview ? 1 : 0));
+        defines.insert(std::make_pair("SAMPLES",
+            static_cast<int>(m_samples)));
 
         m_finalization_vs_obj.compile(defines);
         m_finalization_fs_obj.compile(defines);
         m_lighting_fs_obj.compile(defines);
+
+        if (m_multiview)
+        {
+            m_finalization_gs_obj.compile(defines);
+        }
     }
     catch (shader_compilation_error const& e)
     {
@@ -27,7 +27,11 @@ public:
     ProgramFinalization();
 
     void set_multisampling(bool enable);
+
+    // Samples resolved per pixel when multisampling.
+    void set_samples(unsigned int samples);
     void set_smooth(bool enable);
+    void set_multiview(bool enable);
 
 private:
     void initialize_shader_obj();
@@ -35,9 +39,11 @@ private:
 
 private:
     glVertexShader    m_finalization_vs_obj;
+    glGeometryShader  m_finalization_gs_obj;
     glFragmentShader  m_finalization_fs_obj, m_lighting_fs_obj;
 
-    bool m_smooth, m_multisampling;
+    bool m_smooth, m_multisampling, m_multiview;
+    unsigned int m_samples;
 };
 
 #endif // PROGRAM_FINALIZATION_HPP
@@ -0,0 +1,51 @@
+#include "program_hiz.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+extern unsigned char const hiz_cs_glsl[];
+
+ProgramHiz::ProgramHiz()
+{
+    initialize_shader_obj();
+    initialize_program_obj();
+}
+
+void
+ProgramHiz::initialize_shader_obj()
+{
+    m_hiz_cs_obj.load_from_cstr(
+        reinterpret_cast<char const*>(hiz_cs_glsl));
+
+    attach_shader(m_hiz_cs_obj);
+}
+
+void
+ProgramHiz::initialize_program_obj()
+{
+    try
+    {
+        std::map<std::string, int> defines;
+        defines.insert(std::make_pair("WORK_GROUP_SIZE",
+            static_cast<int>(work_group_size)));
+
+        m_hiz_cs_obj.compile(defines);
+    }
+    catch (shader_compilation_error const& e)
+    {
+        std::cerr << "Error: A shader failed to compile." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        link();
+    }
+    catch (shader_link_error const& e)
+    {
+        std::cerr << "Error: A program failed to link." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
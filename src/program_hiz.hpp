@@ -0,0 +1,27 @@
+#ifndef PROGRAM_HIZ_HPP
+#define PROGRAM_HIZ_HPP
+
+#include "compute_shader.hpp"
+
+#include <GLviz/program.hpp>
+
+// Builds one level of a hierarchical depth (Hi-Z) pyramid storing the
+// farthest depth of the covered pixels, level zero is copied from a depth
+// texture.
+class ProgramHiz : public glProgram
+{
+
+public:
+    ProgramHiz();
+
+    static unsigned int const work_group_size = 8;
+
+private:
+    void initialize_shader_obj();
+    void initialize_program_obj();
+
+private:
+    ComputeShader m_hiz_cs_obj;
+};
+
+#endif // PROGRAM_HIZ_HPP
@@ -0,0 +1,64 @@
+#include "program_hole_fill.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+extern unsigned char const finalization_vs_glsl[];
+extern unsigned char const hole_fill_fs_glsl[];
+
+ProgramHoleFill::ProgramHoleFill()
+{
+    initialize_shader_obj();
+    initialize_program_obj();
+}
+
+void
+ProgramHoleFill::initialize_shader_obj()
+{
+    m_finalization_vs_obj.load_from_cstr(
+        reinterpret_cast<char const*>(finalization_vs_glsl));
+    m_hole_fill_fs_obj.load_from_cstr(
+        reinterpret_cast<char const*>(hole_fill_fs_glsl));
+
+    attach_shader(m_finalization_vs_obj);
+    attach_shader(m_hole_fill_fs_obj);
+}
+
+void
+ProgramHoleFill::initialize_program_obj()
+{
+    try
+    {
+        std::map<std::string, int> defines;
+
+        m_finalization_vs_obj.compile(defines);
+        m_hole_fill_fs_obj.compile(defines);
+    }
+    catch (shader_compilation_error const& e)
+    {
+        std::cerr << "Error: A shader failed to compile." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        link();
+    }
+    catch (shader_link_error const& e)
+    {
+        std::cerr << "Error: A program failed to link." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        set_uniform_block_binding("Camera", 0);
+    }
+    catch (uniform_not_found_error const& e)
+    {
+        std::cerr << "Warning: Failed to set a uniform variable." << std::endl
+            << e.what() << std::endl;
+    }
+}
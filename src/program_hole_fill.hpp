@@ -0,0 +1,23 @@
+#ifndef PROGRAM_HOLE_FILL_HPP
+#define PROGRAM_HOLE_FILL_HPP
+
+#include <GLviz/program.hpp>
+
+// Writes the color and depth of the holes filled by the pull-push pyramid
+// into the framebuffer, all other pixels are discarded.
+class ProgramHoleFill : public glProgram
+{
+
+public:
+    ProgramHoleFill();
+
+private:
+    void initialize_shader_obj();
+    void initialize_program_obj();
+
+private:
+    glVertexShader    m_finalization_vs_obj;
+    glFragmentShader  m_hole_fill_fs_obj;
+};
+
+#endif // PROGRAM_HOLE_FILL_HPP
@@ -0,0 +1,54 @@
+#include "program_output.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+extern unsigned char const finalization_vs_glsl[];
+extern unsigned char const output_fs_glsl[];
+
+ProgramOutput::ProgramOutput()
+{
+    initialize_shader_obj();
+    initialize_program_obj();
+}
+
+void
+ProgramOutput::initialize_shader_obj()
+{
+    m_finalization_vs_obj.load_from_cstr(
+        reinterpret_cast<char const*>(finalization_vs_glsl));
+    m_output_fs_obj.load_from_cstr(
+        reinterpret_cast<char const*>(output_fs_glsl));
+
+    attach_shader(m_finalization_vs_obj);
+    attach_shader(m_output_fs_obj);
+}
+
+void
+ProgramOutput::initialize_program_obj()
+{
+    try
+    {
+        std::map<std::string, int> defines;
+
+        m_finalization_vs_obj.compile(defines);
+        m_output_fs_obj.compile(defines);
+    }
+    catch (shader_compilation_error const& e)
+    {
+        std::cerr << "Error: A shader failed to compile." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        link();
+    }
+    catch (shader_link_error const& e)
+    {
+        std::cerr << "Error: A program failed to link." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
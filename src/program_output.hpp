@@ -0,0 +1,24 @@
+#ifndef PROGRAM_OUTPUT_HPP
+#define PROGRAM_OUTPUT_HPP
+
+#include <GLviz/program.hpp>
+
+// Converts the color of a frame into the 8 bit RGBA of the output images
+// and its depth into the linear depth and preview of the depth outputs,
+// with the rows flipped upside down.
+class ProgramOutput : public glProgram
+{
+
+public:
+    ProgramOutput();
+
+private:
+    void initialize_shader_obj();
+    void initialize_program_obj();
+
+private:
+    glVertexShader    m_finalization_vs_obj;
+    glFragmentShader  m_output_fs_obj;
+};
+
+#endif // PROGRAM_OUTPUT_HPP
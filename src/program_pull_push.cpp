@@ -0,0 +1,63 @@
+#include "program_pull_push.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+extern unsigned char const pull_push_cs_glsl[];
+
+ProgramPullPush::ProgramPullPush(unsigned int pass)
+    : m_pass(pass)
+{
+    initialize_shader_obj();
+    initialize_program_obj();
+}
+
+void
+ProgramPullPush::initialize_shader_obj()
+{
+    m_pull_push_cs_obj.load_from_cstr(
+        reinterpret_cast<char const*>(pull_push_cs_glsl));
+
+    attach_shader(m_pull_push_cs_obj);
+}
+
+void
+ProgramPullPush::initialize_program_obj()
+{
+    try
+    {
+        std::map<std::string, int> defines;
+        defines.insert(std::make_pair("PASS", static_cast<int>(m_pass)));
+        defines.insert(std::make_pair("WORK_GROUP_SIZE",
+            static_cast<int>(work_group_size)));
+
+        m_pull_push_cs_obj.compile(defines);
+    }
+    catch (shader_compilation_error const& e)
+    {
+        std::cerr << "Error: A shader failed to compile." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        link();
+    }
+    catch (shader_link_error const& e)
+    {
+        std::cerr << "Error: A program failed to link." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        set_uniform_block_binding("Camera", 0);
+    }
+    catch (uniform_not_found_error const& e)
+    {
+        std::cerr << "Warning: Failed to set a uniform variable." << std::endl
+            << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef PROGRAM_PULL_PUSH_HPP
+#define PROGRAM_PULL_PUSH_HPP
+
+#include "compute_shader.hpp"
+
+#include <GLviz/program.hpp>
+
+// Pull-push pyramid over color and depth for filling holes between splats.
+// The pull pass builds one level from the next finer one, level zero is
+// copied from the framebuffer, averaging only the nearest surface of every
+// texel. The push pass hands the surface of dense texels down to the sparse
+// texels of the next finer level and writes the filled holes at level zero.
+class ProgramPullPush : public glProgram
+{
+
+public:
+    static unsigned int const pull_pass = 0;
+    static unsigned int const push_pass = 1;
+
+    explicit ProgramPullPush(unsigned int pass);
+
+    static unsigned int const work_group_size = 8;
+
+private:
+    void initialize_shader_obj();
+    void initialize_program_obj();
+
+private:
+    ComputeShader m_pull_push_cs_obj;
+
+    unsigned int m_pass;
+};
+
+#endif // PROGRAM_PULL_PUSH_HPP
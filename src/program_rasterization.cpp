@@ -0,0 +1,90 @@
+#include "program_rasterization.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+extern unsigned char const rasterization_cs_glsl[];
+
+ProgramRasterization::ProgramRasterization(unsigned int pass)
+    : m_pass(pass), m_backface_culling(false), m_color_material(false)
+{
+    initialize_shader_obj();
+    initialize_program_obj();
+}
+
+void
+ProgramRasterization::set_backface_culling(bool enable)
+{
+    if (m_backface_culling != enable)
+    {
+        m_backface_culling = enable;
+        initialize_program_obj();
+    }
+}
+
+void
+ProgramRasterization::set_color_material(bool enable)
+{
+    if (m_color_material != enable)
+    {
+        m_color_material = enable;
+        initialize_program_obj();
+    }
+}
+
+void
+ProgramRasterization::initialize_shader_obj()
+{
+    m_rasterization_cs_obj.load_from_cstr(
+        reinterpret_cast<char const*>(rasterization_cs_glsl));
+
+    attach_shader(m_rasterization_cs_obj);
+}
+
+void
+ProgramRasterization::initialize_program_obj()
+{
+    try
+    {
+        std::map<std::string, int> defines;
+        defines.insert(std::make_pair("PASS", static_cast<int>(m_pass)));
+        defines.insert(std::make_pair("BACKFACE_CULLING",
+            m_backface_culling ? 1 : 0));
+        defines.insert(std::make_pair("COLOR_MATERIAL",
+            m_color_material ? 1 : 0));
+        defines.insert(std::make_pair("WORK_GROUP_SIZE",
+            static_cast<int>(work_group_size)));
+
+        m_rasterization_cs_obj.compile(defines);
+    }
+    catch (shader_compilation_error const& e)
+    {
+        std::cerr << "Error: A shader failed to compile." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        link();
+    }
+    catch (shader_link_error const& e)
+    {
+        std::cerr << "Error: A program failed to link." << std::endl
+            << e.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    try
+    {
+        set_uniform_block_binding("Camera", 0);
+        set_uniform_block_binding("Raycast", 1);
+        set_uniform_block_binding("Frustum", 2);
+        set_uniform_block_binding("Parameter", 3);
+    }
+    catch (uniform_not_found_error const& e)
+    {
+        std::cerr << "Warning: Failed to set a uniform variable." << std::endl
+            << e.what() << std::endl;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef PROGRAM_RASTERIZATION_HPP
+#define PROGRAM_RASTERIZATION_HPP
+
+#include "compute_shader.hpp"
+
+#include <GLviz/program.hpp>
+
+// Software rasterizer for tiny splats. The clear pass resets an r32ui depth
+// image, the depth pass splats the nearest window space depth per pixel
+// with atomics and the color pass writes the color of the surfels matching
+// it into an rgba32f image.
+class ProgramRasterization : public glProgram
+{
+
+public:
+    static unsigned int const clear_pass = 0;
+    static unsigned int const depth_pass = 1;
+    static unsigned int const color_pass = 2;
+
+    explicit ProgramRasterization(unsigned int pass);
+
+    void set_backface_culling(bool enable = true);
+    void set_color_material(bool enable = true);
+
+    static unsigned int const work_group_size = 256;
+
+private:
+    void initialize_shader_obj();
+    void initialize_program_obj();
+
+private:
+    ComputeShader m_rasterization_cs_obj;
+
+    unsigned int m_pass;
+    bool m_backface_culling, m_color_material;
+};
+
+#endif // PROGRAM_RASTERIZATION_HPP
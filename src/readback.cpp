@@ -0,0 +1,196 @@
+#include "readback.hpp"
+
+#include <algorithm>
+
+AsyncReadback::AsyncReadback(unsigned int frames_in_flight)
+    : m_slots(std::max(frames_in_flight, 1u)), m_first(0), m_count(0)
+{
+    for (Slot& slot : m_slots)
+    {
+        glGenBuffers(1, &slot.pbo);
+
+        slot.capacity = slot.size = 0;
+        slot.fence = 0;
+    }
+}
+
+AsyncReadback::~AsyncReadback()
+{
+    for (Slot& slot : m_slots)
+    {
+        if (slot.fence)
+        {
+            glDeleteSync(slot.fence);
+        }
+
+        glDeleteBuffers(1, &slot.pbo);
+    }
+}
+
+unsigned int
+AsyncReadback::frames_in_flight() const
+{
+    return static_cast<unsigned int>(m_slots.size());
+}
+
+void
+AsyncReadback::read(std::vector<Image> const& images,
+    std::vector<Buffer> const& buffers, GLsizei width, GLsizei height,
+    Callback const& callback)
+{
+    poll();
+
+    if (m_count == m_slots.size())
+    {
+        complete(true);
+    }
+
+    Slot& slot = m_slots[(m_first + m_count) % m_slots.size()];
+
+    // Images and then buffers follow each other in the buffer, each one
+    // aligned for any of the pixel types.
+    GLsizeiptr pixels = static_cast<GLsizeiptr>(width) * height;
+
+    slot.offsets.clear();
+    slot.size = 0;
+
+    for (Image const& image : images)
+    {
+        slot.offsets.push_back(slot.size);
+        slot.size += (image.pixel_size * pixels + 15) & ~GLsizeiptr(15);
+    }
+
+    for (Buffer const& buffer : buffers)
+    {
+        slot.offsets.push_back(slot.size);
+        slot.size += (buffer.size + 15) & ~GLsizeiptr(15);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+
+    // Buffers only grow, views of mixed resolutions thus do not
+    // reallocate them over and over.
+    if (slot.capacity < slot.size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, slot.size, nullptr,
+            GL_STREAM_READ);
+        slot.capacity = slot.size;
+    }
+
+    // With a pack buffer bound the pointer is an offset into it and the
+    // copy is merely queued.
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    for (std::size_t i(0); i < images.size(); ++i)
+    {
+        glBindTexture(GL_TEXTURE_2D, images[i].texture);
+        glGetTexImage(GL_TEXTURE_2D, 0, images[i].format, images[i].type,
+            reinterpret_cast<GLvoid*>(slot.offsets[i]));
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, slot.pbo);
+
+    for (std::size_t i(0); i < buffers.size(); ++i)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, buffers[i].buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+            slot.offsets[images.size() + i], buffers[i].size);
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.callback = callback;
+
+    // Submits the copies and the fence, otherwise polling could not see
+    // the fence signal before the next wait flushes it.
+    glFlush();
+
+    ++m_count;
+}
+
+void
+AsyncReadback::poll()
+{
+    while (m_count > 0 && complete(false))
+    {
+    }
+}
+
+void
+AsyncReadback::finish()
+{
+    while (m_count > 0)
+    {
+        complete(true);
+    }
+}
+
+bool
+AsyncReadback::complete(bool wait)
+{
+    Slot& slot = m_slots[m_first];
+
+    GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+        0);
+
+    while (wait && status == GL_TIMEOUT_EXPIRED)
+    {
+        status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+            1000000);
+    }
+
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        return false;
+    }
+
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    m_first = (m_first + 1) % m_slots.size();
+    --m_count;
+
+    Callback callback;
+    callback.swap(slot.callback);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    unsigned char const* data = static_cast<unsigned char const*>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size,
+        GL_MAP_READ_BIT));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    std::vector<void const*> images;
+    for (GLintptr offset : slot.offsets)
+    {
+        images.push_back(data + offset);
+    }
+
+    // The buffer is unmapped even if writing the images fails.
+    auto unmap = [&slot]()
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    };
+
+    try
+    {
+        callback(images.data());
+    }
+    catch (...)
+    {
+        unmap();
+        throw;
+    }
+
+    unmap();
+
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef READBACK_HPP
+#define READBACK_HPP
+
+#include <GL/glew.h>
+
+#include <functional>
+#include <vector>
+
+// Reads textures back into pixel buffer objects without waiting for the
+// GPU. Every read is followed by a fence and its buffer is only mapped
+// once the fence signaled, the renderer meanwhile goes on with the next
+// frames. A read into a full ring first completes the oldest one, which is
+// the only point where the CPU waits for the GPU.
+class AsyncReadback
+{
+
+public:
+    // Level 0 of a 2D texture and the format and type its pixels are read
+    // as, pixel_size bytes each. Rows are packed tightly.
+    struct Image
+    {
+        GLuint texture;
+        GLenum format, type;
+        GLsizei pixel_size;
+    };
+
+    // The first bytes of a buffer object, copied along with the images.
+    struct Buffer
+    {
+        GLuint buffer;
+        GLsizeiptr size;
+    };
+
+    // Receives one pointer per image of a completed read in the order the
+    // images were passed, rows as stored in the textures, followed by one
+    // per buffer. The pointers are valid for the duration of the call only.
+    typedef std::function<void(void const* const* images)> Callback;
+
+    explicit AsyncReadback(unsigned int frames_in_flight);
+    ~AsyncReadback();
+
+    unsigned int frames_in_flight() const;
+
+    // Starts reading the images of the given size and the buffers into a
+    // single buffer, completed reads are handed to their callbacks in order.
+    void read(std::vector<Image> const& images,
+        std::vector<Buffer> const& buffers, GLsizei width, GLsizei height,
+        Callback const& callback);
+
+    // Completes the reads whose fences signaled already.
+    void poll();
+
+    // Waits for and completes all reads in flight.
+    void finish();
+
+private:
+    struct Slot
+    {
+        GLuint pbo;
+        GLsizeiptr capacity, size;
+        std::vector<GLintptr> offsets;
+        GLsync fence;
+        Callback callback;
+    };
+
+    // Maps the buffer of the oldest read and hands it to its callback,
+    // returns false if its fence did not signal and waiting is not allowed.
+    bool complete(bool wait);
+
+private:
+    std::vector<Slot> m_slots;
+
+    // Oldest read in flight and the number of reads in flight.
+    unsigned int m_first;
+    unsigned int m_count;
+};
+
+#endif // READBACK_HPP
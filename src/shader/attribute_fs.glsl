@@ -17,9 +17,22 @@
 
 #version 330
 
-#define VISIBILITY_PASS  0
-#define SMOOTH           0
-#define EWA_FILTER       0
+#define VISIBILITY_PASS    0
+#define SMOOTH             0
+#define EWA_FILTER         0
+#define MULTIVIEW          0
+#define MAX_VIEWS          16
+#define OVERDRAW           0
+#define CONSERVATIVE_DEPTH 0
+#define HOMOGRAPHY         0
+
+#if OVERDRAW
+    #extension GL_ARB_shader_atomic_counters : require
+#endif
+
+#if CONSERVATIVE_DEPTH
+    #extension GL_ARB_conservative_depth : require
+#endif
 
 layout(std140, column_major) uniform Camera
 {
@@ -41,10 +54,42 @@ layout(std140) uniform Parameter
     float radius_scale;
     float ewa_radius;
     float epsilon;
+    float lod_scale;
 };
 
+#if MULTIVIEW
+    // Per view cameras of a layered framebuffer, the view of a primitive
+    // is its instance.
+    struct View
+    {
+        mat4 modelview_matrix;
+        mat4 modelview_matrix_it;
+        mat4 projection_matrix;
+        mat4 projection_matrix_inv;
+        vec4 frustum_plane[6];
+    };
+
+    layout(std140, column_major) uniform Views
+    {
+        View views[MAX_VIEWS];
+    };
+
+    #define VIEW_INDEX In.view
+    #define modelview_matrix views[VIEW_INDEX].modelview_matrix
+    #define modelview_matrix_it views[VIEW_INDEX].modelview_matrix_it
+    #define projection_matrix views[VIEW_INDEX].projection_matrix
+    #define projection_matrix_inv views[VIEW_INDEX].projection_matrix_inv
+    #define frustum_plane views[VIEW_INDEX].frustum_plane
+#endif
+
 uniform sampler1D filter_kernel;
 
+#if OVERDRAW
+    // Fragments inside of the splats, whether or not they pass the depth
+    // test afterwards.
+    layout(binding = 0, offset = 0) uniform atomic_uint overdraw;
+#endif
+
 in block
 {
     flat in vec3 c_eye;
@@ -53,18 +98,34 @@ in block
     flat in vec3 p;
     flat in vec3 n_eye;
 
+    #if HOMOGRAPHY
+        flat in mat3 homography;
+        flat in vec3 depth_row;
+    #endif
+
     #if !VISIBILITY_PASS
         #if EWA_FILTER
             flat in vec2 c_scr;
         #endif
         flat in vec3 color;
     #endif
+
+    #if MULTIVIEW
+        flat in int view;
+    #endif
 }
 In;
 
 #define FRAG_COLOR 0
 layout(location = FRAG_COLOR) out vec4 frag_color;
 
+#if CONSERVATIVE_DEPTH
+    // The point sprite lies at the depth of the point of the splat closest
+    // to the viewer, so the written depth never decreases and fragments
+    // behind the depth buffer are rejected before they are shaded.
+    layout(depth_greater) out float gl_FragDepth;
+#endif
+
 #if !VISIBILITY_PASS
     #if SMOOTH
         #define FRAG_NORMAL 1
@@ -74,6 +135,14 @@ layout(location = FRAG_COLOR) out vec4 frag_color;
 
 void main()
 {
+#if HOMOGRAPHY
+    // Splat coordinates and depth by the mapping of the vertex shader.
+    vec3 x = vec3(gl_FragCoord.xy, 1.0);
+    vec3 uvw = In.homography * x;
+
+    vec2 u = uvw.xy / uvw.z;
+    float zval = dot(In.depth_row, x) / uvw.z;
+#else
     vec4 p_ndc = vec4(2.0 * (gl_FragCoord.xy - viewport.xy)
         / (viewport.zw) - 1.0, -1.0, 1.0);
     vec4 p_eye = projection_matrix_inv * p_ndc;
@@ -84,6 +153,8 @@ void main()
 
     vec2 u = vec2(dot(In.u_eye, d) / dot(In.u_eye, In.u_eye),
                   dot(In.v_eye, d) / dot(In.v_eye, In.v_eye));
+    float zval = q.z;
+#endif
 
     if (dot(vec3(u, 1.0), In.p) < 0)
     {
@@ -91,7 +162,6 @@ void main()
     }
 
     float w3d = length(u);
-    float zval = q.z;
 
     #if !VISIBILITY_PASS && EWA_FILTER
         float w2d = distance(gl_FragCoord.xy, In.c_scr) / ewa_radius;
@@ -113,6 +183,10 @@ void main()
         discard;
     }
 
+    #if OVERDRAW
+        atomicCounterIncrement(overdraw);
+    #endif
+
     #if !VISIBILITY_PASS
         #if EWA_FILTER
             float alpha = texture(filter_kernel, dist).r;
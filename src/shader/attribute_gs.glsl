@@ -0,0 +1,177 @@
+#version 330
+
+#define VISIBILITY_PASS    0
+#define EWA_FILTER         0
+#define MULTIVIEW          0
+#define QUADS              0
+#define CONSERVATIVE_DEPTH 0
+#define HOMOGRAPHY         0
+#define MAX_VIEWS          16
+
+// Expands splats into quads and routes the splats of an instanced
+// multi-view draw to the layer of their view, all other attributes pass
+// through unchanged.
+layout(points) in;
+
+#if QUADS
+    layout(triangle_strip, max_vertices = 4) out;
+#else
+    layout(points, max_vertices = 1) out;
+#endif
+
+#if QUADS
+    layout(std140, column_major) uniform Camera
+    {
+        mat4 modelview_matrix;
+        mat4 modelview_matrix_it;
+        mat4 projection_matrix;
+    };
+
+    #if MULTIVIEW
+        struct View
+        {
+            mat4 modelview_matrix;
+            mat4 modelview_matrix_it;
+            mat4 projection_matrix;
+            mat4 projection_matrix_inv;
+            vec4 frustum_plane[6];
+        };
+
+        layout(std140, column_major) uniform Views
+        {
+            View views[MAX_VIEWS];
+        };
+
+        #define projection_matrix views[In[0].view].projection_matrix
+    #endif
+#endif
+
+in block
+{
+    flat vec3 c_eye;
+    flat vec3 u_eye;
+    flat vec3 v_eye;
+    flat vec3 p;
+    flat vec3 n_eye;
+
+    #if HOMOGRAPHY
+        flat mat3 homography;
+        flat vec3 depth_row;
+    #endif
+
+    #if !VISIBILITY_PASS
+        #if EWA_FILTER
+            flat vec2 c_scr;
+        #endif
+        flat vec3 color;
+    #endif
+
+    #if MULTIVIEW
+        flat int view;
+    #endif
+}
+In[];
+
+out block
+{
+    flat vec3 c_eye;
+    flat vec3 u_eye;
+    flat vec3 v_eye;
+    flat vec3 p;
+    flat vec3 n_eye;
+
+    #if HOMOGRAPHY
+        flat mat3 homography;
+        flat vec3 depth_row;
+    #endif
+
+    #if !VISIBILITY_PASS
+        #if EWA_FILTER
+            flat vec2 c_scr;
+        #endif
+        flat vec3 color;
+    #endif
+
+    #if MULTIVIEW
+        flat int view;
+    #endif
+}
+Out;
+
+void
+emit(vec4 position)
+{
+    gl_Position = position;
+    gl_PointSize = gl_in[0].gl_PointSize;
+
+#if MULTIVIEW
+    gl_Layer = In[0].view;
+#endif
+
+    Out.c_eye = In[0].c_eye;
+    Out.u_eye = In[0].u_eye;
+    Out.v_eye = In[0].v_eye;
+    Out.p = In[0].p;
+    Out.n_eye = In[0].n_eye;
+
+#if HOMOGRAPHY
+    Out.homography = In[0].homography;
+    Out.depth_row = In[0].depth_row;
+#endif
+
+#if !VISIBILITY_PASS
+    #if EWA_FILTER
+        Out.c_scr = In[0].c_scr;
+    #endif
+    Out.color = In[0].color;
+#endif
+
+#if MULTIVIEW
+    Out.view = In[0].view;
+#endif
+
+    EmitVertex();
+}
+
+void main()
+{
+    // Culled splats are moved outside of the clip volume by the vertex
+    // shader, there is nothing to emit for them.
+    if (gl_in[0].gl_Position.w == 0.0)
+    {
+        return;
+    }
+
+#if QUADS
+    // The square circumscribing the elliptical splat in its plane projects
+    // onto a quadrilateral circumscribing the projected ellipse, clipping
+    // takes care of corners behind the viewer.
+    vec3 c = In[0].c_eye, u = In[0].u_eye, v = In[0].v_eye;
+
+    vec4 corner[4];
+    corner[0] = projection_matrix * vec4(c - u - v, 1.0);
+    corner[1] = projection_matrix * vec4(c + u - v, 1.0);
+    corner[2] = projection_matrix * vec4(c - u + v, 1.0);
+    corner[3] = projection_matrix * vec4(c + u + v, 1.0);
+
+    #if CONSERVATIVE_DEPTH
+        // All of the quad at the depth the vertex shader bounded the
+        // splat with.
+        float z_near = gl_in[0].gl_Position.z / gl_in[0].gl_Position.w;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            corner[i].z = z_near * corner[i].w;
+        }
+    #endif
+
+    for (int i = 0; i < 4; ++i)
+    {
+        emit(corner[i]);
+    }
+#else
+    emit(gl_in[0].gl_Position);
+#endif
+
+    EndPrimitive();
+}
@@ -23,6 +23,19 @@
 #define COLOR_MATERIAL     0
 #define EWA_FILTER         0
 #define POINTSIZE_METHOD   0
+#define LOD                0
+#define MULTIVIEW          0
+#define MAX_VIEWS          16
+#define CONSERVATIVE_DEPTH 0
+#define QUADS              0
+#define CAPTURE            0
+#define CAPTURED           0
+#define HOMOGRAPHY         0
+
+#if CAPTURE || CAPTURED
+    #extension GL_ARB_shader_storage_buffer_object : require
+    #extension GL_ARB_shading_language_420pack : require
+#endif
 
 layout(std140, column_major) uniform Camera
 {
@@ -49,8 +62,34 @@ layout(std140) uniform Parameter
     float radius_scale;
     float ewa_radius;
     float epsilon;
+    float lod_scale;
 };
 
+#if MULTIVIEW
+    // Per view cameras of a layered framebuffer, the view of a primitive
+    // is its instance.
+    struct View
+    {
+        mat4 modelview_matrix;
+        mat4 modelview_matrix_it;
+        mat4 projection_matrix;
+        mat4 projection_matrix_inv;
+        vec4 frustum_plane[6];
+    };
+
+    layout(std140, column_major) uniform Views
+    {
+        View views[MAX_VIEWS];
+    };
+
+    #define VIEW_INDEX gl_InstanceID
+    #define modelview_matrix views[VIEW_INDEX].modelview_matrix
+    #define modelview_matrix_it views[VIEW_INDEX].modelview_matrix_it
+    #define projection_matrix views[VIEW_INDEX].projection_matrix
+    #define projection_matrix_inv views[VIEW_INDEX].projection_matrix_inv
+    #define frustum_plane views[VIEW_INDEX].frustum_plane
+#endif
+
 #define ATTR_CENTER 0
 layout(location = ATTR_CENTER) in vec3 c;
 
@@ -66,6 +105,12 @@ layout(location = ATTR_PLANE) in vec3 p;
 #define ATTR_COLOR 4
 layout(location = ATTR_COLOR) in vec4 rgba;
 
+#if LOD
+    // Geometric error of the hierarchy node and of its parent.
+    #define ATTR_ERROR 5
+    layout(location = ATTR_ERROR) in vec2 error;
+#endif
+
 out block
 {
     flat out vec3 c_eye;
@@ -74,15 +119,53 @@ out block
     flat out vec3 p;
     flat out vec3 n_eye;
 
+    #if HOMOGRAPHY
+        flat out mat3 homography;
+        flat out vec3 depth_row;
+    #endif
+
     #if !VISIBILITY_PASS
         #if EWA_FILTER
             flat out vec2 c_scr;
         #endif
         flat out vec3 color;
     #endif
+
+    #if MULTIVIEW
+        flat out int view;
+    #endif
 }
 Out;
 
+#if CAPTURE || CAPTURED
+    // Projection of a splat as computed by the visibility pass, culled
+    // splats have a position with a w of zero.
+    struct Splat
+    {
+        vec4 position;
+        vec4 c_eye;     // Point size in w.
+        vec4 u_eye;
+        vec4 v_eye;
+    };
+
+    #if CAPTURE
+        layout(std430, binding = 0) writeonly buffer SplatBuffer
+    #else
+        layout(std430, binding = 0) readonly buffer SplatBuffer
+    #endif
+    {
+        Splat splat[];
+    };
+
+    // Splats of all views are stored one after another.
+    #if MULTIVIEW
+        uniform int num_pts;
+        #define SPLAT_INDEX (gl_InstanceID * num_pts + gl_VertexID)
+    #else
+        #define SPLAT_INDEX gl_VertexID
+    #endif
+#endif
+
 #if !VISIBILITY_PASS
     vec3 lighting(vec3 n_eye, vec3 v_eye, vec3 color, float shininess);
 #endif
@@ -329,16 +412,54 @@ pointsprite(in vec3 c, in vec3 u, in vec3 v,
 #endif
 }
 
-void main()
+// Culled splats are moved outside of the clip volume.
+void
+cull_splat()
 {
-    vec4 c_eye = modelview_matrix * vec4(c, 1.0);
-    vec3 u_eye = radius_scale * mat3(modelview_matrix) * u;
-    vec3 v_eye = radius_scale * mat3(modelview_matrix) * v;
-    vec3 n_eye = normalize(cross(u_eye, v_eye));
+    gl_Position = vec4(1.0, 0.0, 0.0, 0.0);
 
-    vec4 p_scr;
-    vec2 w;
-    pointsprite(c_eye.xyz, u_eye, v_eye, p_scr, w);
+#if CAPTURE
+    splat[SPLAT_INDEX].position = gl_Position;
+#endif
+}
+
+void
+output_splat(vec4 position, vec3 c_eye, vec3 u_eye, vec3 v_eye,
+    vec3 n_eye, float point_size)
+{
+    // Pointsprite position.
+    gl_Position = position;
+
+    Out.c_eye = c_eye;
+    Out.u_eye = u_eye;
+    Out.v_eye = v_eye;
+    Out.p = p;
+    Out.n_eye = n_eye;
+
+#if HOMOGRAPHY
+    // Window coordinates map linearly to the view ray through the pixel
+    // and rays map projectively to splat coordinates, so that the
+    // fragment shader needs a single matrix product per pixel. Its third
+    // row is the splat plane and the depth row scales the ray such that
+    // dividing both yields the eye space depth of the intersection.
+    mat3 window_to_ray = mat3(
+        vec3(projection_matrix_inv[0]),
+        vec3(projection_matrix_inv[1]),
+        vec3(projection_matrix_inv[3] - projection_matrix_inv[2]))
+        * mat3(vec3(2.0 / viewport.z, 0.0, 0.0),
+            vec3(0.0, 2.0 / viewport.w, 0.0),
+            vec3(-2.0 * viewport.xy / viewport.zw - 1.0, 1.0));
+
+    float cn = dot(c_eye, n_eye);
+    mat3 ray_to_splat = transpose(mat3(
+        (cn * u_eye - dot(u_eye, c_eye) * n_eye) / dot(u_eye, u_eye),
+        (cn * v_eye - dot(v_eye, c_eye) * n_eye) / dot(v_eye, v_eye),
+        n_eye));
+
+    Out.homography = ray_to_splat * window_to_ray;
+    Out.depth_row = cn * vec3(window_to_ray[0].z, window_to_ray[1].z,
+        window_to_ray[2].z);
+#endif
 
 #if !VISIBILITY_PASS
 //    #if SMOOTH
@@ -349,46 +470,103 @@ void main()
         #endif
 //    #else
 //        #if COLOR_MATERIAL
-//            Out.color = lighting(n_eye, vec3(c_eye), material_color,
+//            Out.color = lighting(n_eye, c_eye, material_color,
 //                                 material_shininess);
 //        #else
-//            Out.color = lighting(n_eye, vec3(c_eye), vec3(rgba),
+//            Out.color = lighting(n_eye, c_eye, vec3(rgba),
 //                                 material_shininess);
 //        #endif
 //    #endif
 #endif
 
-#if BACKFACE_CULLING
-    // Backface culling
-    if (dot(n_eye, -vec3(c_eye)) > 0.0)
-    {
+#if !VISIBILITY_PASS && EWA_FILTER
+    Out.c_scr = vec2((position.xy + 1.0) * viewport.zw * 0.5);
+    gl_PointSize = max(2.0, point_size);
+#else
+    gl_PointSize = point_size;
 #endif
-        // Pointsprite position.
-        gl_Position = p_scr;
-        
-        Out.c_eye = vec3(c_eye);
-        Out.u_eye = u_eye;
-        Out.v_eye = v_eye;
-        Out.p = p;
-        Out.n_eye = n_eye;
-
-        // Pointsprite size. One additional pixel
-        // avoids artifacts.
-        float point_size = max(w[0] * viewport.z,
-            w[1] * viewport.w) + 1.0;
 
-#if !VISIBILITY_PASS && EWA_FILTER
-        Out.c_scr = vec2((p_scr.xy + 1.0) * viewport.zw * 0.5);
-        gl_PointSize = max(2.0, point_size);
+#if CAPTURE
+    splat[SPLAT_INDEX] = Splat(position, vec4(c_eye, point_size),
+        vec4(u_eye, 0.0), vec4(v_eye, 0.0));
+#endif
+}
+
+void main()
+{
+#if MULTIVIEW
+    Out.view = gl_InstanceID;
+#endif
+
+#if CAPTURED
+    // The visibility pass already transformed and bounded the splat.
+    Splat s = splat[SPLAT_INDEX];
+
+    if (s.position.w == 0.0)
+    {
+        cull_splat();
+        return;
+    }
+
+    output_splat(s.position, s.c_eye.xyz, s.u_eye.xyz, s.v_eye.xyz,
+        normalize(cross(s.u_eye.xyz, s.v_eye.xyz)), s.c_eye.w);
 #else
-        gl_PointSize = point_size;
+    vec4 c_eye = modelview_matrix * vec4(c, 1.0);
+    vec3 u_eye = radius_scale * mat3(modelview_matrix) * u;
+    vec3 v_eye = radius_scale * mat3(modelview_matrix) * v;
+    vec3 n_eye = normalize(cross(u_eye, v_eye));
+
+#if LOD
+    // Only nodes of the cut through the hierarchy are drawn, i.e. their
+    // own error is tolerable at this distance but that of their parent
+    // is not.
+    float lod_error = lod_scale * length(vec3(c_eye));
+    if (error.x > lod_error || error.y <= lod_error)
+    {
+        cull_splat();
+        return;
+    }
 #endif
 
 #if BACKFACE_CULLING
-    }
-    else
+    // Backface culling
+    if (dot(n_eye, -vec3(c_eye)) <= 0.0)
     {
-        gl_Position = vec4(1.0, 0.0, 0.0, 0.0);
+        cull_splat();
+        return;
     }
 #endif
+
+    vec4 p_scr;
+    vec2 w;
+#if QUADS
+    // The geometry shader expands the splat into a quad, the projected
+    // center only tells it apart from culled splats.
+    p_scr = projection_matrix * c_eye;
+    w = vec2(0.0);
+#else
+    pointsprite(c_eye.xyz, u_eye, v_eye, p_scr, w);
+#endif
+
+#if CONSERVATIVE_DEPTH
+    // Depth of the point of the splat closest to the viewer, which
+    // bounds the depth the fragment shader writes. The radius is
+    // enlarged slightly to stay conservative under rounding.
+    float r = 1.001 * max(length(u_eye), length(v_eye));
+    vec4 p_near = projection_matrix * vec4(c_eye.xy, c_eye.z + r, 1.0);
+    float z_near = p_near.w > 0.0
+        ? clamp(p_near.z / p_near.w, -1.0, 1.0) : -1.0;
+
+    vec4 position = vec4(p_scr.xy, z_near * p_scr.w, p_scr.w);
+#else
+    vec4 position = p_scr;
+#endif
+
+    // Pointsprite size. One additional pixel
+    // avoids artifacts.
+    float point_size = max(w[0] * viewport.z,
+        w[1] * viewport.w) + 1.0;
+
+    output_splat(position, vec3(c_eye), u_eye, v_eye, n_eye, point_size);
+#endif
 }
@@ -0,0 +1,291 @@
+#version 430
+
+#define BACKFACE_CULLING  0
+#define HIZ               0
+#define INPUT             0
+#define WORK_GROUP_SIZE   256
+
+// Surfels the pass runs over.
+#define INPUT_ALL         0
+#define INPUT_LIST        1
+#define INPUT_CHUNKS      2
+
+layout(local_size_x = WORK_GROUP_SIZE) in;
+
+layout(std140, column_major) uniform Camera
+{
+    mat4 modelview_matrix;
+    mat4 modelview_matrix_it;
+    mat4 projection_matrix;
+};
+
+layout(std140, column_major) uniform Raycast
+{
+    mat4 projection_matrix_inv;
+    vec4 viewport;
+};
+
+layout(std140) uniform Frustum
+{
+    vec4 frustum_plane[6];
+};
+
+layout(std140) uniform Parameter
+{
+    vec3 material_color;
+    float material_shininess;
+    float radius_scale;
+    float ewa_radius;
+    float epsilon;
+    float lod_scale;
+};
+
+uniform int num_pts;
+
+#if INPUT == INPUT_LIST
+// Indices of the surfels drawn by the visibility pass, their count is that
+// of its draw command. They were frustum culled already.
+layout(std430, binding = 3) readonly buffer InputBuffer
+{
+    uint input_index[];
+};
+
+layout(std430, binding = 4) readonly buffer InputCommand
+{
+    uint input_count;
+};
+#elif INPUT == INPUT_CHUNKS
+// Chunks of consecutive surfels drawn by the visibility pass, one work
+// group each.
+uniform int num_chunks;
+
+struct Chunk
+{
+    // Bounding sphere of the surfel centers and the largest splat radius.
+    vec3 center;
+    float extent;
+    float radius;
+    uint first;
+    uint count;
+};
+
+layout(std430, binding = 3) readonly buffer ChunkBuffer
+{
+    Chunk chunk[];
+};
+#endif
+
+#if HIZ
+// Farthest depth pyramid of the visibility pass.
+uniform sampler2D hiz;
+#endif
+
+// Surfels as uploaded by the renderer, i.e. tightly packed structs of four
+// vec3 (center, u, v, clipping plane) and a packed rgba color.
+#define SURFEL_SIZE 13u
+
+layout(std430, binding = 0) readonly buffer SurfelBuffer
+{
+    float surfel[];
+};
+
+layout(std430, binding = 1) writeonly buffer IndexBuffer
+{
+    uint index[];
+};
+
+// Indices are written starting at first_index, so that several commands can
+// share one index buffer.
+layout(std430, binding = 2) buffer DrawCommand
+{
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+
+shared uint local_count;
+shared uint local_base;
+
+vec3
+surfel_vec3(uint i, uint offset)
+{
+    uint k = i * SURFEL_SIZE + offset;
+    return vec3(surfel[k], surfel[k + 1u], surfel[k + 2u]);
+}
+
+#if HIZ
+bool
+occluded(vec3 c_eye, float r)
+{
+    // Spheres intersecting the near plane have no proper screen bounds.
+    if (dot(frustum_plane[5], vec4(c_eye, 1.0)) < r)
+    {
+        return false;
+    }
+
+    // Screen bounds of the eye space bounding box of the sphere.
+    vec2 ndc_min = vec2(1.0), ndc_max = vec2(-1.0);
+
+    for (int j = 0; j < 8; ++j)
+    {
+        vec3 d = vec3((j & 1) == 0 ? -r : r, (j & 2) == 0 ? -r : r,
+            (j & 4) == 0 ? -r : r);
+        vec4 p = projection_matrix * vec4(c_eye + d, 1.0);
+
+        ndc_min = min(ndc_min, p.xy / p.w);
+        ndc_max = max(ndc_max, p.xy / p.w);
+    }
+
+    ndc_min = clamp(ndc_min, -1.0, 1.0);
+    ndc_max = clamp(ndc_max, -1.0, 1.0);
+
+    vec2 px_min = viewport.xy + (0.5 * ndc_min + 0.5) * viewport.zw;
+    vec2 px_max = viewport.xy + (0.5 * ndc_max + 0.5) * viewport.zw;
+
+    // Pick the level at which the bounds cover at most 2x2 texels.
+    vec2 extent = px_max - px_min;
+    int level = int(ceil(log2(max(max(extent.x, extent.y), 1.0))));
+    level = min(level, textureQueryLevels(hiz) - 1);
+
+    ivec2 size = textureSize(hiz, level);
+    ivec2 t0 = min(ivec2(px_min) >> level, size - 1);
+    ivec2 t1 = min(ivec2(px_max) >> level, size - 1);
+
+    float depth = 0.0;
+
+    for (int y = t0.y; y <= t1.y; ++y)
+    {
+        for (int x = t0.x; x <= t1.x; ++x)
+        {
+            depth = max(depth, texelFetch(hiz, ivec2(x, y), level).r);
+        }
+    }
+
+    // Window depth of the point of the sphere closest to the viewer.
+    vec4 p = projection_matrix * vec4(c_eye.xy, c_eye.z + r, 1.0);
+
+    return 0.5 * p.z / p.w + 0.5 > depth;
+}
+#endif
+
+bool
+visible(uint i)
+{
+    vec3 c_eye = vec3(modelview_matrix * vec4(surfel_vec3(i, 0u), 1.0));
+    vec3 u_eye = radius_scale * mat3(modelview_matrix) * surfel_vec3(i, 3u);
+    vec3 v_eye = radius_scale * mat3(modelview_matrix) * surfel_vec3(i, 6u);
+
+    // Bounding sphere against the frustum planes.
+    float r = max(length(u_eye), length(v_eye));
+
+#if INPUT != INPUT_LIST
+    for (int j = 0; j < 6; ++j)
+    {
+        if (dot(frustum_plane[j], vec4(c_eye, 1.0)) < -r)
+        {
+            return false;
+        }
+    }
+#endif
+
+#if BACKFACE_CULLING
+    // Same test as in the vertex shader.
+    if (dot(cross(u_eye, v_eye), -c_eye) <= 0.0)
+    {
+        return false;
+    }
+#endif
+
+#if HIZ
+    if (occluded(c_eye, r))
+    {
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+#if INPUT == INPUT_CHUNKS
+bool
+chunk_occluded(uint c)
+{
+    vec3 c_eye = vec3(modelview_matrix * vec4(chunk[c].center, 1.0));
+
+    return occluded(c_eye, chunk[c].extent + radius_scale * chunk[c].radius);
+}
+#endif
+
+void main()
+{
+    // Large point clouds exceed the maximum work group count in a single
+    // dimension, the renderer then dispatches a 2D grid.
+#if INPUT == INPUT_CHUNKS
+    // The threads of a work group stride over the surfels of its chunk,
+    // which are skipped altogether if its bounds are occluded.
+    uint group = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+
+    if (group >= uint(num_chunks))
+    {
+        return;
+    }
+
+    uint first = chunk[group].first;
+    uint last = first + chunk[group].count;
+    uint num_steps = chunk_occluded(group) ? 0u
+        : (last - first + gl_WorkGroupSize.x - 1u) / gl_WorkGroupSize.x;
+#else
+    uint k = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x
+        + gl_GlobalInvocationID.x;
+    uint num_steps = 1u;
+#endif
+
+    for (uint step = 0u; step < num_steps; ++step)
+    {
+#if INPUT == INPUT_CHUNKS
+        uint i = first + step * gl_WorkGroupSize.x + gl_LocalInvocationIndex;
+        bool keep = i < last && visible(i);
+#elif INPUT == INPUT_LIST
+        uint i = k < input_count ? input_index[k] : 0u;
+        bool keep = k < input_count && visible(i);
+#else
+        uint i = k;
+        bool keep = i < uint(num_pts) && visible(i);
+#endif
+
+        if (gl_LocalInvocationIndex == 0u)
+        {
+            local_count = 0u;
+        }
+
+        barrier();
+
+        // Compact within the work group first so that there is only a
+        // single atomic operation on the draw command per work group. The
+        // order of the work groups in the output is not deterministic.
+        uint local_index = 0u;
+        if (keep)
+        {
+            local_index = atomicAdd(local_count, 1u);
+        }
+
+        barrier();
+
+        if (gl_LocalInvocationIndex == 0u)
+        {
+            local_base = atomicAdd(count, local_count);
+        }
+
+        barrier();
+
+        if (keep)
+        {
+            index[first_index + local_base + local_index] = i;
+        }
+
+        // The shared counters are reset for the next step.
+        barrier();
+    }
+}
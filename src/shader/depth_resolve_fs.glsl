@@ -0,0 +1,17 @@
+#version 330
+
+// Depth splatted by the compute rasterizer, stored as float bits.
+uniform usampler2D depth_texture;
+
+void main()
+{
+    float depth = uintBitsToFloat(
+        texelFetch(depth_texture, ivec2(gl_FragCoord.xy), 0).r);
+
+    if (depth >= 1.0)
+    {
+        discard;
+    }
+
+    gl_FragDepth = depth;
+}
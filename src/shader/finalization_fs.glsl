@@ -18,7 +18,9 @@
 #version 330
 
 #define MULTISAMPLING  0
+#define SAMPLES        4
 #define SMOOTH         0
+#define MULTIVIEW      0
 
 layout(std140, column_major) uniform Camera
 {
@@ -40,10 +42,13 @@ layout(std140) uniform Parameter
     float radius_scale;
     float ewa_radius;
     float epsilon;
+    float lod_scale;
 };
 
 #if MULTISAMPLING
     uniform sampler2DMS color_texture;
+#elif MULTIVIEW
+    uniform sampler2DArray color_texture;
 #else
     uniform sampler2D color_texture;
 #endif
@@ -52,6 +57,9 @@ layout(std140) uniform Parameter
     #if MULTISAMPLING
         uniform sampler2DMS normal_texture;
         uniform sampler2DMS depth_texture;
+    #elif MULTIVIEW
+        uniform sampler2DArray normal_texture;
+        uniform sampler2DArray depth_texture;
     #else
         uniform sampler2D normal_texture;
         uniform sampler2D depth_texture;
@@ -63,6 +71,10 @@ layout(std140) uniform Parameter
 in block
 {
     vec2 texture_uv;
+
+    #if MULTIVIEW
+        flat int layer;
+    #endif
 }
 In;
 
@@ -75,7 +87,7 @@ void main()
 #if MULTISAMPLING
     ivec2 itexture_uv = ivec2(textureSize(color_texture) * In.texture_uv);
 
-    for (int i = 0; i < 4; ++i)
+    for (int i = 0; i < SAMPLES; ++i)
 #endif
     {
     #if MULTISAMPLING
@@ -87,6 +99,14 @@ void main()
             );
         float depth = texelFetch(depth_texture, ivec2(itexture_uv), i).r;
         #endif
+    #elif MULTIVIEW
+        vec3 texture_uvw = vec3(In.texture_uv, float(In.layer));
+        vec4 pixel = texture(color_texture, texture_uvw);
+
+        #if SMOOTH
+        vec3 normal = normalize(texture(normal_texture, texture_uvw).xyz);
+        float depth = texture(depth_texture, texture_uvw).r;
+        #endif
     #else
         vec4 pixel = texture(color_texture, In.texture_uv);
 
@@ -121,7 +141,7 @@ void main()
     }
 
     #if MULTISAMPLING
-        frag_color = sqrt(res / 4.0);
+        frag_color = sqrt(res / float(SAMPLES));
     #else
         frag_color = res;
     #endif
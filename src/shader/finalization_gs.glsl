@@ -0,0 +1,35 @@
+#version 330
+
+// Routes the screen quad instance of each view to its layer.
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+in block
+{
+    vec2 texture_uv;
+    flat int layer;
+}
+In[];
+
+out block
+{
+    vec2 texture_uv;
+    flat int layer;
+}
+Out;
+
+void main()
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        gl_Position = gl_in[i].gl_Position;
+        gl_Layer = In[i].layer;
+
+        Out.texture_uv = In[i].texture_uv;
+        Out.layer = In[i].layer;
+
+        EmitVertex();
+    }
+
+    EndPrimitive();
+}
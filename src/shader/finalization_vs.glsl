@@ -17,6 +17,8 @@
 
 #version 330
 
+#define MULTIVIEW 0
+
 #define ATTR_POSITION 0
 layout(location = ATTR_POSITION) in vec3 position;
 
@@ -27,6 +29,10 @@ layout(location = ATTR_TEXTURE_UV)
 out block
 {
     vec2 texture_uv;
+
+    #if MULTIVIEW
+        flat int layer;
+    #endif
 }
 Out;
 
@@ -34,4 +40,8 @@ void main()
 {
     gl_Position = vec4(position, 1.0);
     Out.texture_uv = texture_uv;
+
+#if MULTIVIEW
+    Out.layer = gl_InstanceID;
+#endif
 }
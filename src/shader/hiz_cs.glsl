@@ -0,0 +1,58 @@
+#version 430
+
+#define WORK_GROUP_SIZE 8
+
+layout(local_size_x = WORK_GROUP_SIZE, local_size_y = WORK_GROUP_SIZE) in;
+
+// Either the depth texture of the framebuffer (src_level < 0) or the
+// pyramid itself, in which case src_level is the next finer level.
+uniform sampler2D src;
+uniform int src_level;
+
+layout(r32f, binding = 0) writeonly uniform image2D dst;
+
+void main()
+{
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(dst);
+
+    if (p.x >= size.x || p.y >= size.y)
+    {
+        return;
+    }
+
+    if (src_level < 0)
+    {
+        imageStore(dst, p, vec4(texelFetch(src, p, 0).r));
+        return;
+    }
+
+    ivec2 src_size = textureSize(src, src_level);
+
+    // Levels are halved and rounded down, the last texel of a row or
+    // column thus also covers the odd texel of the finer level.
+    ivec2 q0 = 2 * p;
+    ivec2 q1 = min(q0 + 1, src_size - 1);
+
+    if (p.x == size.x - 1)
+    {
+        q1.x = src_size.x - 1;
+    }
+
+    if (p.y == size.y - 1)
+    {
+        q1.y = src_size.y - 1;
+    }
+
+    float depth = 0.0;
+
+    for (int y = q0.y; y <= q1.y; ++y)
+    {
+        for (int x = q0.x; x <= q1.x; ++x)
+        {
+            depth = max(depth, texelFetch(src, ivec2(x, y), src_level).r);
+        }
+    }
+
+    imageStore(dst, p, vec4(depth));
+}
@@ -0,0 +1,29 @@
+#version 330
+
+layout(std140, column_major) uniform Camera
+{
+    mat4 modelview_matrix;
+    mat4 modelview_matrix_it;
+    mat4 projection_matrix;
+};
+
+// Color and eye space distance of the filled holes, zero elsewhere.
+uniform sampler2D fill_texture;
+
+#define FRAG_COLOR 0
+layout(location = FRAG_COLOR) out vec4 frag_color;
+
+void main()
+{
+    vec4 fill = texelFetch(fill_texture, ivec2(gl_FragCoord.xy), 0);
+
+    if (fill.a == 0.0)
+    {
+        discard;
+    }
+
+    frag_color = vec4(fill.rgb, 1.0);
+
+    float ndc = projection_matrix[3][2] / fill.a - projection_matrix[2][2];
+    gl_FragDepth = 0.5 * ndc + 0.5;
+}
@@ -0,0 +1,42 @@
+#version 330
+
+// Color and window depth of the frame, single sampled.
+uniform sampler2D color_texture;
+uniform sampler2D depth_texture;
+
+// Entries (2, 2) and (2, 3) of the projection matrix.
+uniform float prj_mat22;
+uniform float prj_mat23;
+
+// Image rows are stored top to bottom, OpenGL stores them bottom up.
+#define FRAG_COLOR 0
+layout(location = FRAG_COLOR) out uvec4 frag_color;
+
+// Distance along the view axis, 0 for the far plane, and its 8 bit
+// visualisation.
+#define FRAG_DEPTH 1
+layout(location = FRAG_DEPTH) out float frag_depth;
+
+#define FRAG_PREVIEW 2
+layout(location = FRAG_PREVIEW) out uint frag_preview;
+
+void main()
+{
+    ivec2 size = textureSize(color_texture, 0);
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 q = ivec2(p.x, size.y - 1 - p.y);
+
+    vec4 color = texelFetch(color_texture, q, 0);
+
+    // Truncated like the conversion on the CPU, so that the images do not
+    // change by a bit.
+    frag_color = uvec4(clamp(color, 0.0, 1.0) * 255.0);
+
+    // Empty space is at distance 0 as in the original article.
+    float depth = texelFetch(depth_texture, q, 0).r;
+    float distance = abs(depth - 1.0) < 0.00001 ? 0.0
+        : 1.0 / (((depth * 2.0 - 1.0) + prj_mat22) / prj_mat23);
+
+    frag_depth = distance;
+    frag_preview = uint(clamp((255.0 / 100.0) * distance, 0.0, 255.0));
+}
@@ -0,0 +1,190 @@
+#version 430
+
+#define PASS            0
+#define WORK_GROUP_SIZE 8
+
+// Relative distance behind the nearest surface of a texel up to which the
+// surfels it covers are averaged, farther ones are background.
+#define DEPTH_TOLERANCE 0.05
+
+// Coverage above which a texel is dense enough to fill the holes below.
+#define MIN_COVERAGE    0.5
+
+layout(local_size_x = WORK_GROUP_SIZE, local_size_y = WORK_GROUP_SIZE) in;
+
+layout(std140, column_major) uniform Camera
+{
+    mat4 modelview_matrix;
+    mat4 modelview_matrix_it;
+    mat4 projection_matrix;
+};
+
+// Texels of the pyramid hold the average color of the nearest surface in
+// rgb and the fraction of covered pixels in alpha, the depth levels hold
+// the eye space distance of that surface.
+uniform sampler2D color_src;
+uniform sampler2D depth_src;
+
+#if PASS == 0
+
+// Either the textures of the framebuffer (src_level < 0) or the pyramid
+// itself, in which case src_level is the next finer level.
+uniform int src_level;
+
+layout(rgba32f, binding = 0) writeonly uniform image2D dst_color;
+layout(r32f, binding = 1) writeonly uniform image2D dst_depth;
+
+void main()
+{
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(dst_color);
+
+    if (p.x >= size.x || p.y >= size.y)
+    {
+        return;
+    }
+
+    if (src_level < 0)
+    {
+        vec4 pixel = texelFetch(color_src, p, 0);
+
+        if (pixel.a > 0.0)
+        {
+            float ndc = 2.0 * texelFetch(depth_src, p, 0).r - 1.0;
+            float distance = projection_matrix[3][2]
+                / (ndc + projection_matrix[2][2]);
+
+            imageStore(dst_color, p, vec4(pixel.rgb / pixel.a, 1.0));
+            imageStore(dst_depth, p, vec4(distance));
+        }
+        else
+        {
+            imageStore(dst_color, p, vec4(0.0));
+            imageStore(dst_depth, p, vec4(0.0));
+        }
+
+        return;
+    }
+
+    ivec2 src_size = textureSize(color_src, src_level);
+
+    // Levels are halved and rounded down, the last texel of a row or
+    // column thus also covers the odd texel of the finer level.
+    ivec2 q0 = 2 * p;
+    ivec2 q1 = min(q0 + 1, src_size - 1);
+
+    if (p.x == size.x - 1)
+    {
+        q1.x = src_size.x - 1;
+    }
+
+    if (p.y == size.y - 1)
+    {
+        q1.y = src_size.y - 1;
+    }
+
+    float front = 0.0;
+
+    for (int y = q0.y; y <= q1.y; ++y)
+    {
+        for (int x = q0.x; x <= q1.x; ++x)
+        {
+            if (texelFetch(color_src, ivec2(x, y), src_level).a > 0.0)
+            {
+                float distance = texelFetch(depth_src, ivec2(x, y),
+                    src_level).r;
+                front = front == 0.0 ? distance : min(front, distance);
+            }
+        }
+    }
+
+    // Background behind the nearest surface counts as covered but does
+    // not contribute to the color and depth filled into its holes.
+    float coverage = 0.0, weight = 0.0, distance = 0.0;
+    vec3 color = vec3(0.0);
+
+    for (int y = q0.y; y <= q1.y; ++y)
+    {
+        for (int x = q0.x; x <= q1.x; ++x)
+        {
+            vec4 c = texelFetch(color_src, ivec2(x, y), src_level);
+            float z = texelFetch(depth_src, ivec2(x, y), src_level).r;
+
+            coverage += c.a;
+
+            if (c.a > 0.0 && z <= front * (1.0 + DEPTH_TOLERANCE))
+            {
+                weight += c.a;
+                color += c.a * c.rgb;
+                distance += c.a * z;
+            }
+        }
+    }
+
+    ivec2 extent = q1 - q0 + 1;
+    coverage /= float(extent.x * extent.y);
+
+    if (weight > 0.0)
+    {
+        imageStore(dst_color, p, vec4(color / weight, coverage));
+        imageStore(dst_depth, p, vec4(distance / weight));
+    }
+    else
+    {
+        imageStore(dst_color, p, vec4(0.0));
+        imageStore(dst_depth, p, vec4(0.0));
+    }
+}
+
+#else
+
+// Level written by this pass, the next coarser one has been pushed into
+// already. Level zero writes the color and distance of the filled holes to
+// the fill image, zero where nothing is filled.
+uniform int dst_level;
+
+layout(rgba32f, binding = 0) writeonly uniform image2D dst_color;
+layout(r32f, binding = 1) writeonly uniform image2D dst_depth;
+layout(rgba32f, binding = 2) writeonly uniform image2D fill;
+
+void main()
+{
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = textureSize(color_src, dst_level);
+
+    if (p.x >= size.x || p.y >= size.y)
+    {
+        return;
+    }
+
+    vec4 color = texelFetch(color_src, p, dst_level);
+    float distance = texelFetch(depth_src, p, dst_level).r;
+
+    ivec2 q = min(p / 2, textureSize(color_src, dst_level + 1) - 1);
+    vec4 parent = texelFetch(color_src, q, dst_level + 1);
+
+    if (dst_level == 0)
+    {
+        if (color.a == 0.0 && parent.a > MIN_COVERAGE)
+        {
+            imageStore(fill, p, vec4(parent.rgb,
+                texelFetch(depth_src, q, dst_level + 1).r));
+        }
+        else
+        {
+            imageStore(fill, p, vec4(0.0));
+        }
+
+        return;
+    }
+
+    // Sparse texels take over the surface of a dense parent, holes thus
+    // are filled from the finest level dense enough around them.
+    if (color.a <= MIN_COVERAGE && parent.a > MIN_COVERAGE)
+    {
+        imageStore(dst_color, p, parent);
+        imageStore(dst_depth, p, texelFetch(depth_src, q, dst_level + 1));
+    }
+}
+
+#endif
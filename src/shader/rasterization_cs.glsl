@@ -0,0 +1,175 @@
+#version 430
+
+#define PASS              1
+#define BACKFACE_CULLING  0
+#define COLOR_MATERIAL    0
+#define WORK_GROUP_SIZE   256
+
+// Clears the depth image, splats the nearest depth per pixel with 32 bit
+// atomics and finally writes the color of the surfels matching it.
+#define CLEAR_PASS  0
+#define DEPTH_PASS  1
+#define COLOR_PASS  2
+
+layout(local_size_x = WORK_GROUP_SIZE) in;
+
+layout(std140, column_major) uniform Camera
+{
+    mat4 modelview_matrix;
+    mat4 modelview_matrix_it;
+    mat4 projection_matrix;
+};
+
+layout(std140, column_major) uniform Raycast
+{
+    mat4 projection_matrix_inv;
+    vec4 viewport;
+};
+
+layout(std140) uniform Frustum
+{
+    vec4 frustum_plane[6];
+};
+
+layout(std140) uniform Parameter
+{
+    vec3 material_color;
+    float material_shininess;
+    float radius_scale;
+    float ewa_radius;
+    float epsilon;
+    float lod_scale;
+};
+
+uniform int num_pts;
+
+#define SURFEL_SIZE 13u
+
+layout(std430, binding = 0) readonly buffer SurfelBuffer
+{
+    float surfel[];
+};
+
+// Window space depth as uint, the order of non-negative floats is kept.
+layout(r32ui, binding = 0) uniform uimage2D depth_image;
+
+// The hard z-buffer renders into an 8 bit color attachment.
+#if PASS == COLOR_PASS
+    layout(rgba8, binding = 1) writeonly uniform image2D color_image;
+#endif
+
+vec3
+surfel_vec3(uint i, uint offset)
+{
+    uint k = i * SURFEL_SIZE + offset;
+    return vec3(surfel[k], surfel[k + 1u], surfel[k + 2u]);
+}
+
+void
+splat(uint i)
+{
+    vec3 c_eye = vec3(modelview_matrix * vec4(surfel_vec3(i, 0u), 1.0));
+    vec3 u_eye = radius_scale * mat3(modelview_matrix) * surfel_vec3(i, 3u);
+    vec3 v_eye = radius_scale * mat3(modelview_matrix) * surfel_vec3(i, 6u);
+    vec3 p = surfel_vec3(i, 9u);
+    vec3 n_eye = normalize(cross(u_eye, v_eye));
+
+    float r = max(length(u_eye), length(v_eye));
+
+    for (int j = 0; j < 6; ++j)
+    {
+        if (dot(frustum_plane[j], vec4(c_eye, 1.0)) < -r)
+        {
+            return;
+        }
+    }
+
+#if BACKFACE_CULLING
+    if (dot(n_eye, -c_eye) <= 0.0)
+    {
+        return;
+    }
+#endif
+
+#if PASS == COLOR_PASS
+    #if COLOR_MATERIAL
+        vec3 color = material_color;
+    #else
+        vec3 color = unpackUnorm4x8(
+            floatBitsToUint(surfel[i * SURFEL_SIZE + 12u])).rgb;
+    #endif
+#endif
+
+    // Screen bounds of the bounding sphere, with one pixel of margin.
+    vec4 c_clip = projection_matrix * vec4(c_eye, 1.0);
+    vec2 c_scr = viewport.xy
+        + (0.5 * c_clip.xy / c_clip.w + 0.5) * viewport.zw;
+
+    float z = max(-c_eye.z - r, 1e-6);
+    vec2 r_scr = 0.5 * r * vec2(projection_matrix[0][0],
+        projection_matrix[1][1]) * viewport.zw / z + 1.0;
+
+    ivec2 px_min = ivec2(max(floor(c_scr - r_scr), viewport.xy));
+    ivec2 px_max = ivec2(min(ceil(c_scr + r_scr),
+        viewport.xy + viewport.zw - 1.0));
+
+    // Same ray casting as in the fragment shader of the attribute pass.
+    for (int y = px_min.y; y <= px_max.y; ++y)
+    {
+        for (int x = px_min.x; x <= px_max.x; ++x)
+        {
+            vec2 frag_coord = vec2(x, y) + 0.5;
+
+            vec4 p_ndc = vec4(2.0 * (frag_coord - viewport.xy)
+                / viewport.zw - 1.0, -1.0, 1.0);
+            vec4 p_eye = projection_matrix_inv * p_ndc;
+            vec3 qn = p_eye.xyz / p_eye.w;
+
+            vec3 q = qn * dot(c_eye, n_eye) / dot(qn, n_eye);
+            vec3 d = q - c_eye;
+
+            vec2 uv = vec2(dot(u_eye, d) / dot(u_eye, u_eye),
+                           dot(v_eye, d) / dot(v_eye, v_eye));
+
+            if (dot(vec3(uv, 1.0), p) < 0.0 || length(uv) > 1.0)
+            {
+                continue;
+            }
+
+            float depth = -projection_matrix[3][2] * (1.0 / q.z)
+                - projection_matrix[2][2];
+            uint zval = floatBitsToUint(0.5 * depth + 0.5);
+
+#if PASS == DEPTH_PASS
+            imageAtomicMin(depth_image, ivec2(x, y), zval);
+#elif PASS == COLOR_PASS
+            // The last of the splats of equal depth to store its color wins.
+            if (imageLoad(depth_image, ivec2(x, y)).r == zval)
+            {
+                imageStore(color_image, ivec2(x, y), vec4(color, 1.0));
+            }
+#endif
+        }
+    }
+}
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.y * gl_NumWorkGroups.x * gl_WorkGroupSize.x
+        + gl_GlobalInvocationID.x;
+
+#if PASS == CLEAR_PASS
+    ivec2 size = imageSize(depth_image);
+
+    if (i < uint(size.x * size.y))
+    {
+        imageStore(depth_image, ivec2(i % uint(size.x), i / uint(size.x)),
+            uvec4(floatBitsToUint(1.0)));
+    }
+#else
+    if (i < uint(num_pts))
+    {
+        splat(i);
+    }
+#endif
+}
@@ -0,0 +1,224 @@
+#include "splat_hierarchy.hpp"
+#include "morton_order.hpp"
+
+#include "splat_renderer.hpp"
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+using namespace Eigen;
+
+namespace
+{
+
+float
+splat_radius(Surfel const& s)
+{
+    return std::max(s.u.norm(), s.v.norm());
+}
+
+// Merges two splats into a circular one bounding both, its normal and
+// color are averaged weighted by the splat areas.
+Surfel
+merge(Surfel const& a, Surfel const& b)
+{
+    Vector3f n_a = a.u.cross(a.v), n_b = b.u.cross(b.v);
+    float w_a = std::max(n_a.norm(), 1e-12f);
+    float w_b = std::max(n_b.norm(), 1e-12f);
+    float w = w_a + w_b;
+
+    Vector3f c = (w_a * a.c + w_b * b.c) / w;
+
+    // The normals are weighted by the areas through their lengths.
+    Vector3f n = n_a + n_b;
+    if (n.squaredNorm() < 1e-24f)
+    {
+        n = w_a >= w_b ? n_a : n_b;
+    }
+    n.normalize();
+
+    float radius = std::max((a.c - c).norm() + splat_radius(a),
+        (b.c - c).norm() + splat_radius(b));
+
+    Vector3f t = n.unitOrthogonal();
+
+    unsigned int rgba = 0;
+    for (unsigned int i(0); i < 4; ++i)
+    {
+        float ca = static_cast<float>((a.rgba >> (8 * i)) & 0xffu);
+        float cb = static_cast<float>((b.rgba >> (8 * i)) & 0xffu);
+
+        unsigned int ci = static_cast<unsigned int>(
+            (w_a * ca + w_b * cb) / w + 0.5f);
+        rgba |= std::min(ci, 255u) << (8 * i);
+    }
+
+    return Surfel(c, radius * t, radius * n.cross(t), Vector3f::Zero(),
+        rgba);
+}
+
+}
+
+SplatHierarchy::SplatHierarchy()
+    : m_num_leaves(0)
+{
+}
+
+void
+SplatHierarchy::build(std::vector<Surfel> const& surfels)
+{
+    clear();
+
+    if (surfels.empty())
+    {
+        return;
+    }
+
+    m_num_leaves = static_cast<unsigned int>(surfels.size());
+
+    // Neighboring leaves of the Morton order are merged first.
+    std::vector<Surfel> leaves(surfels);
+    sort_morton(leaves);
+
+    m_nodes.reserve(2 * leaves.size() - 1);
+    m_errors.reserve(2 * leaves.size() - 1);
+    m_node_block.reserve(2 * leaves.size() - 1);
+
+    // Block 0 holds the nodes above the subtrees of the other blocks.
+    m_blocks.resize(1);
+
+    unsigned int root = build_node(leaves, 0, m_num_leaves, 0);
+    m_errors[root].y() = std::numeric_limits<float>::infinity();
+
+    // Sort by block and decreasing parent error within each block.
+    std::vector<unsigned int> order(m_nodes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+        [this](unsigned int i, unsigned int j)
+        {
+            if (m_node_block[i] != m_node_block[j])
+            {
+                return m_node_block[i] < m_node_block[j];
+            }
+
+            return m_errors[i].y() > m_errors[j].y();
+        });
+
+    std::vector<Surfel> nodes(m_nodes.size());
+    std::vector<Vector2f> errors(m_errors.size());
+    for (unsigned int i(0); i < order.size(); ++i)
+    {
+        nodes[i] = m_nodes[order[i]];
+        errors[i] = m_errors[order[i]];
+    }
+
+    m_nodes.swap(nodes);
+    m_errors.swap(errors);
+
+    for (unsigned int i(0); i < order.size(); ++i)
+    {
+        Block& block = m_blocks[m_node_block[order[i]]];
+        Vector3f const& c = m_nodes[i].c;
+
+        if (block.count == 0)
+        {
+            block.first = i;
+            block.box_min = block.box_max = c;
+        }
+
+        block.box_min = block.box_min.cwiseMin(c);
+        block.box_max = block.box_max.cwiseMax(c);
+        ++block.count;
+    }
+
+    m_node_block.clear();
+    m_node_block.shrink_to_fit();
+}
+
+void
+SplatHierarchy::clear()
+{
+    m_nodes.clear();
+    m_errors.clear();
+    m_node_block.clear();
+    m_blocks.clear();
+    m_num_leaves = 0;
+}
+
+unsigned int
+SplatHierarchy::build_node(std::vector<Surfel> const& leaves,
+    unsigned int begin, unsigned int end, unsigned int block)
+{
+    // The largest subtrees of at most block_leaves leaves start blocks.
+    if (block == 0 && end - begin <= block_leaves)
+    {
+        block = static_cast<unsigned int>(m_blocks.size());
+        m_blocks.push_back(Block{0, 0, Vector3f::Zero(), Vector3f::Zero()});
+    }
+
+    if (end - begin == 1)
+    {
+        m_nodes.push_back(leaves[begin]);
+        m_errors.push_back(Vector2f::Zero());
+        m_node_block.push_back(block);
+
+        return static_cast<unsigned int>(m_nodes.size() - 1);
+    }
+
+    unsigned int mid = (begin + end) / 2;
+
+    unsigned int left = build_node(leaves, begin, mid, block);
+    unsigned int right = build_node(leaves, mid, end, block);
+
+    Surfel node = merge(m_nodes[left], m_nodes[right]);
+    float error = splat_radius(node);
+
+    m_errors[left].y() = error;
+    m_errors[right].y() = error;
+
+    m_nodes.push_back(node);
+    m_errors.push_back(Vector2f(error, 0.0f));
+    m_node_block.push_back(block);
+
+    return static_cast<unsigned int>(m_nodes.size() - 1);
+}
+
+std::vector<Surfel> const&
+SplatHierarchy::nodes() const
+{
+    return m_nodes;
+}
+
+std::vector<Vector2f> const&
+SplatHierarchy::errors() const
+{
+    return m_errors;
+}
+
+std::vector<SplatHierarchy::Block> const&
+SplatHierarchy::blocks() const
+{
+    return m_blocks;
+}
+
+unsigned int
+SplatHierarchy::num_candidates(Block const& block, float error) const
+{
+    auto first = m_errors.begin() + block.first;
+    auto it = std::partition_point(first, first + block.count,
+        [error](Vector2f const& e)
+        {
+            return e.y() > error;
+        });
+
+    return static_cast<unsigned int>(it - first);
+}
+
+unsigned int
+SplatHierarchy::num_leaves() const
+{
+    return m_num_leaves;
+}
@@ -0,0 +1,64 @@
+#ifndef SPLAT_HIERARCHY_HPP
+#define SPLAT_HIERARCHY_HPP
+
+#include <Eigen/Core>
+
+#include <vector>
+
+struct Surfel;
+
+// Level of detail hierarchy in the spirit of sequential point trees. Inner
+// nodes are circular splats bounding their two children with averaged
+// normal and color. Every node stores its geometric error, i.e. its radius
+// (zero for leaves), and the error of its parent. A node belongs to the cut
+// drawn for a view if its error is within the tolerance at its distance to
+// the viewer while the error of its parent is not. The subtrees of up to
+// block_leaves Morton ordered leaves and the nodes above them form blocks,
+// the nodes of each block are sorted by decreasing parent error. The nodes
+// which may belong to the cut form a prefix of each block bounded by the
+// distance of the viewer to the box of the block, the prefixes are drawn
+// and the vertex shader rejects the nodes outside of the cut.
+class SplatHierarchy
+{
+
+public:
+    static const unsigned int block_leaves = 4096;
+
+    // Contiguous nodes and the bounding box of their centers.
+    struct Block
+    {
+        unsigned int first, count;
+        Eigen::Vector3f box_min, box_max;
+    };
+
+    SplatHierarchy();
+
+    void build(std::vector<Surfel> const& surfels);
+    void clear();
+
+    std::vector<Surfel> const& nodes() const;
+
+    // Node error and parent error, the root has an infinite parent error.
+    std::vector<Eigen::Vector2f> const& errors() const;
+
+    std::vector<Block> const& blocks() const;
+
+    // Number of leading nodes of the block whose parent error exceeds the
+    // given error.
+    unsigned int num_candidates(Block const& block, float error) const;
+
+    unsigned int num_leaves() const;
+
+private:
+    unsigned int build_node(std::vector<Surfel> const& leaves,
+        unsigned int begin, unsigned int end, unsigned int block);
+
+private:
+    std::vector<Surfel> m_nodes;
+    std::vector<Eigen::Vector2f> m_errors;
+    std::vector<unsigned int> m_node_block;
+    std::vector<Block> m_blocks;
+    unsigned int m_num_leaves;
+};
+
+#endif // SPLAT_HIERARCHY_HPP
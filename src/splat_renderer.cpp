@@ -16,94 +16,225 @@
 // along with Surface Splatting. If not, see <http://www.gnu.org/licenses/>.
 
 #include "splat_renderer.hpp"
+#include "chunk_hierarchy.hpp"
+#include "splat_hierarchy.hpp"
 
 #include <GLviz/glviz.hpp>
 #include <GLviz/utility.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
 
 using namespace Eigen;
 
-UniformBufferRaycast::UniformBufferRaycast()
-    : glUniformBuffer(sizeof(Matrix4f) + sizeof(Vector4f))
+namespace
 {
-}
 
+// Dispatches one invocation per item, large counts exceed the minimum
+// guaranteed work group count of a single dimension and use a 2D grid.
 void
-UniformBufferRaycast::set_buffer_data(Matrix4f const&
-    projection_matrix_inv, GLint const* viewport)
+dispatch_compute_1d(GLuint num_items, GLuint work_group_size)
 {
-    float viewportf[4] = {
-        static_cast<float>(viewport[0]),
-        static_cast<float>(viewport[1]),
-        static_cast<float>(viewport[2]),
-        static_cast<float>(viewport[3])
-    };
+    GLuint const max_groups = 65535;
+    GLuint num_groups = (num_items + work_group_size - 1) / work_group_size;
+    GLuint num_groups_y = (num_groups + max_groups - 1) / max_groups;
+    GLuint num_groups_x = (num_groups + num_groups_y - 1) / num_groups_y;
 
-    bind();
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Matrix4f),
-        projection_matrix_inv.data());
-    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(Matrix4f),
-        4 * sizeof(float), viewportf);
-    unbind();
+    glDispatchCompute(num_groups_x, num_groups_y, 1);
 }
 
-UniformBufferFrustum::UniformBufferFrustum()
-    : glUniformBuffer(6 * sizeof(Vector4f))
+// Counters of PassStatistics in the order of its members.
+GLenum const pipeline_statistics_targets[4] = {
+    GL_VERTEX_SHADER_INVOCATIONS_ARB,
+    GL_CLIPPING_INPUT_PRIMITIVES_ARB,
+    GL_CLIPPING_OUTPUT_PRIMITIVES_ARB,
+    GL_FRAGMENT_SHADER_INVOCATIONS_ARB
+};
+
+bool
+pipeline_statistics_supported()
 {
+    return GLEW_VERSION_4_6 || GLEW_ARB_pipeline_statistics_query;
 }
 
-void
-UniformBufferFrustum::set_buffer_data(Vector4f const* frustum_plane)
+bool
+atomic_counters_supported()
 {
-    bind();
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, 6 * sizeof(Vector4f),
-        static_cast<void const*>(frustum_plane));
-    unbind();
+    return GLEW_VERSION_4_2 || GLEW_ARB_shader_atomic_counters;
 }
 
-UniformBufferParameter::UniformBufferParameter()
-    : glUniformBuffer(8 * sizeof(float))
+bool
+query_buffers_supported()
 {
+    return GLEW_VERSION_4_4 || GLEW_ARB_query_buffer_object;
 }
 
+// Layout of the counter buffer, the statistics of a frame that are counted
+// on the GPU.
+struct Counters
+{
+    GLuint64 pass[2][4];
+    GLuint num_surfels_visible, num_surfels_unoccluded;
+    GLuint overdraw_fragments, padding;
+};
+
+// Eye space planes, normalized such that the signed distance of a point can
+// be compared against a radius.
 void
-UniformBufferParameter::set_buffer_data(Vector3f const& color, float shininess,
-    float radius_scale, float ewa_radius, float epsilon)
+frustum_planes(Matrix4f const& projection_matrix, Vector4f* frustum_plane)
+{
+    for (unsigned int i(0); i < 6; ++i)
+    {
+        frustum_plane[i] = projection_matrix.row(3) + (-1.0f + 2.0f
+            * static_cast<float>(i % 2)) * projection_matrix.row(i / 2);
+    }
+    
+    for (unsigned int i(0); i < 6; ++i)
+    {
+        frustum_plane[i] = (1.0f / frustum_plane[i].block<3, 1>(
+            0, 0).norm()) * frustum_plane[i];
+    }
+}
+
+// Uniform blocks in the order of their binding points.
+enum UniformBlock
+{
+    camera_block, raycast_block, frustum_block, parameter_block,
+    views_block
+};
+
+// Cameras of the views of a multi-view frame are each a modelview, its
+// inverse transpose, a projection and its inverse matrix followed by the
+// six eye space frustum planes.
+GLsizeiptr const view_size = 4 * sizeof(Matrix4f) + 6 * sizeof(Vector4f);
+
+std::vector<GLsizeiptr>
+uniform_block_sizes(unsigned int max_views)
+{
+    std::vector<GLsizeiptr> sizes(5);
+
+    sizes[camera_block] = 3 * sizeof(Matrix4f);
+    sizes[raycast_block] = sizeof(Matrix4f) + sizeof(Vector4f);
+    sizes[frustum_block] = 6 * sizeof(Vector4f);
+    sizes[parameter_block] = 8 * sizeof(float);
+    sizes[views_block] = max_views * view_size;
+
+    return sizes;
+}
+
+unsigned char*
+copy_matrix(unsigned char* dst, Matrix4f const& matrix)
+{
+    std::memcpy(dst, matrix.data(), sizeof(Matrix4f));
+    return dst + sizeof(Matrix4f);
+}
+
+}
+
+float
+FrameStatistics::culled_fraction() const
+{
+    if (num_surfels == 0)
+    {
+        return 0.0f;
+    }
+
+    return 1.0f - static_cast<float>(num_surfels_unoccluded)
+        / static_cast<float>(num_surfels);
+}
+
+float
+FrameStatistics::occluded_fraction() const
 {
-    bind();
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, 3 * sizeof(float), color.data());
-    glBufferSubData(GL_UNIFORM_BUFFER, 12, sizeof(float), &shininess);
-    glBufferSubData(GL_UNIFORM_BUFFER, 16, sizeof(float), &radius_scale);
-    glBufferSubData(GL_UNIFORM_BUFFER, 20, sizeof(float), &ewa_radius);
-    glBufferSubData(GL_UNIFORM_BUFFER, 24, sizeof(float), &epsilon);
-    unbind();
+    if (num_surfels_visible == 0)
+    {
+        return 0.0f;
+    }
+
+    return 1.0f - static_cast<float>(num_surfels_unoccluded)
+        / static_cast<float>(num_surfels_visible);
 }
 
+float
+FrameStatistics::overdraw() const
+{
+    if (num_pixels == 0)
+    {
+        return 0.0f;
+    }
+
+    return static_cast<float>(overdraw_fragments)
+        / static_cast<float>(num_pixels);
+}
 
 SplatRenderer::SplatRenderer(GLviz::Camera const& camera)
-    : m_camera(camera), m_soft_zbuffer(true), m_smooth(false),
-      m_color_material(true), m_ewa_filter(false), m_multisample(false),
-      m_pointsize_method(0), m_backface_culling(false),
+    : m_camera(camera), m_num_pts(0), m_num_views(0), m_culled_capacity(0),
+      m_command_stride(0), m_chunk_buffer(0), m_hiz_texture(0), m_hiz_width(0),
+      m_hiz_height(0), m_raster_texture(0), m_raster_width(0),
+      m_raster_height(0), m_pull_push_color(0), m_pull_push_depth(0),
+      m_fill_texture(0), m_pull_push_width(0), m_pull_push_height(0),
+      m_pull_push_levels(0), m_output_fbo(0), m_output_textures(),
+      m_output_width(0), m_output_height(0), m_projection_buffer(0),
+      m_projection_capacity(0),
+      m_chunks(nullptr), m_draw_ranges(false), m_bin_size(0),
+      m_bin_pass(false),
+      m_statistics_pending(false), m_overdraw_buffer(0),
+      m_counter_buffer(0), m_counters_pending(false), m_fbo(nullptr),
+      m_soft_zbuffer(true), m_smooth(false), m_color_material(true),
+      m_ewa_filter(false), m_multisample(false), m_gpu_culling(false),
+      m_hiz_culling(false), m_hiz_pass(false), m_cull_pass(false),
+      m_lod(false), m_pipeline_statistics(false),
+      m_conservative_depth(false), m_quads(false),
+      m_shared_projection(false), m_share_pass(false), m_homography(false),
+      m_front_to_back(false),
+      m_pointsize_method(0), m_samples(4), m_hole_filling(0),
+      m_fill_pass(false), m_min_sample_shading(1.0f),
+      m_backface_culling(false),
       m_color(Vector3f(0.0, 0.25f, 1.0f)), m_epsilon(1.0f * 1e-3f),
-      m_shininess(8.0f), m_radius_scale(1.0f), m_ewa_radius(1.0f)
+      m_shininess(8.0f), m_radius_scale(1.0f), m_ewa_radius(1.0f),
+      m_lod_tolerance(1.0f), m_raster_footprint(0.0f), m_tile_x(0),
+      m_tile_y(0), m_image_width(0), m_image_height(0), m_cameras(nullptr),
+      m_uniforms(uniform_block_sizes(max_views))
 {
-    m_uniform_camera.bind_buffer_base(0);
-    m_uniform_raycast.bind_buffer_base(1);
-    m_uniform_frustum.bind_buffer_base(2);
-    m_uniform_parameter.bind_buffer_base(3);
+    // Tracked from here on by reshape.
+    glGetIntegerv(GL_VIEWPORT, m_viewport);
+
+    select_framebuffer();
 
     setup_program_objects();
     setup_filter_kernel();
     setup_screen_size_quad();
     setup_vertex_array_buffer_object();
+    setup_culling_buffer_objects();
+    setup_statistics_objects();
 }
 
 SplatRenderer::~SplatRenderer()
 {
     glDeleteVertexArrays(1, &m_vao);
     glDeleteBuffers(1, &m_vbo);
+    glDeleteBuffers(1, &m_lod_vbo);
+
+    glDeleteBuffers(1, &m_culled_ibo);
+    glDeleteBuffers(1, &m_draw_indirect);
+    glDeleteBuffers(1, &m_chunk_buffer);
+    glDeleteTextures(1, &m_hiz_texture);
+    glDeleteTextures(1, &m_raster_texture);
+    glDeleteTextures(1, &m_pull_push_color);
+    glDeleteTextures(1, &m_pull_push_depth);
+    glDeleteTextures(1, &m_fill_texture);
+    glDeleteFramebuffers(1, &m_output_fbo);
+    glDeleteTextures(1, &m_output_textures.color);
+    glDeleteTextures(1, &m_output_textures.depth);
+    glDeleteTextures(1, &m_output_textures.preview);
+    glDeleteBuffers(1, &m_projection_buffer);
+
+    glDeleteQueries(8, &m_statistics_queries[0][0]);
+    glDeleteBuffers(1, &m_overdraw_buffer);
+    glDeleteBuffers(1, &m_counter_buffer);
 
     glDeleteBuffers(1, &m_rect_vertices_vbo);
     glDeleteBuffers(1, &m_rect_texture_uv_vbo);
@@ -231,7 +362,94 @@ SplatRenderer::setup_vertex_array_buffer_object()
     glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE,
         sizeof(Surfel), reinterpret_cast<const GLbyte*>(48));
 
+    // Node and parent error, only enabled when drawing a hierarchy.
+    glGenBuffers(1, &m_lod_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_lod_vbo);
+    glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE,
+        sizeof(Vector2f), reinterpret_cast<const GLfloat*>(0));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void
+SplatRenderer::setup_statistics_objects()
+{
+    glGenQueries(8, &m_statistics_queries[0][0]);
+    m_pass_statistics[0] = m_pass_statistics[1] = false;
+    m_overdraw_counted = false;
+
+    if (atomic_counters_supported())
+    {
+        glGenBuffers(1, &m_overdraw_buffer);
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_overdraw_buffer);
+        glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(GLuint), nullptr,
+            GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+    }
+
+    glGenBuffers(1, &m_counter_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_counter_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, sizeof(Counters), nullptr,
+        GL_STREAM_COPY);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void
+SplatRenderer::reserve_projection_buffer()
+{
+    GLsizeiptr size = 64 * static_cast<GLsizeiptr>(m_num_pts)
+        * std::max(m_num_views, 1u);
+
+    if (m_projection_buffer == 0)
+    {
+        glGenBuffers(1, &m_projection_buffer);
+    }
+
+    if (m_projection_capacity < size)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_projection_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr,
+            GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        m_projection_capacity = size;
+    }
+}
+
+void
+SplatRenderer::setup_culling_buffer_objects()
+{
+    glGenBuffers(1, &m_culled_ibo);
+    glGenBuffers(1, &m_draw_indirect);
+    glGenBuffers(1, &m_chunk_buffer);
+
+    // The indices of the surfels surviving the culling prepass are drawn
+    // through the vertex array object of the surfels.
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_culled_ibo);
     glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    // Two DrawElementsIndirectCommands (count, instance count, first
+    // index, base vertex and base instance), one for the frustum culling
+    // and one for the occlusion culling pass. Both are bound as shader
+    // storage ranges and thus have to be aligned accordingly.
+    GLintptr const command_size = 5 * sizeof(GLuint);
+    GLint alignment = 1;
+
+    if (gpu_culling_supported())
+    {
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    }
+
+    m_command_stride = (command_size + alignment - 1) / alignment
+        * alignment;
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_draw_indirect);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, 2 * m_command_stride, nullptr,
+        GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 }
 
 bool
@@ -252,13 +470,13 @@ SplatRenderer::set_smooth(bool enable)
 
         if (m_smooth)
         {
-            m_fbo.enable_depth_texture();
-            m_fbo.attach_normal_texture();
+            m_fbo->enable_depth_texture();
+            m_fbo->attach_normal_texture();
         }
         else
         {
-            m_fbo.disable_depth_texture();
-            m_fbo.detach_normal_texture();
+            m_fbo->disable_depth_texture();
+            m_fbo->detach_normal_texture();
         }
     }
 }
@@ -276,6 +494,11 @@ SplatRenderer::set_color_material(bool enable)
     {
         m_color_material = enable;
         m_attribute.set_color_material(enable);
+
+        if (m_raster_color)
+        {
+            m_raster_color->set_color_material(enable);
+        }
     }
 }
 
@@ -293,6 +516,25 @@ SplatRenderer::set_backface_culling(bool enable)
         m_backface_culling = enable;
         m_visibility.set_backface_culling(enable);
         m_attribute.set_backface_culling(enable);
+
+        if (m_culling)
+        {
+            m_culling->set_backface_culling(enable);
+        }
+
+        for (unsigned int i(0); i < ProgramCulling::num_inputs; ++i)
+        {
+            if (m_occlusion[i])
+            {
+                m_occlusion[i]->set_backface_culling(enable);
+            }
+        }
+
+        if (m_raster_depth)
+        {
+            m_raster_depth->set_backface_culling(enable);
+            m_raster_color->set_backface_culling(enable);
+        }
     }
 }
 
@@ -374,205 +616,1709 @@ SplatRenderer::set_multisample(bool enable)
     if (m_multisample != enable)
     {
         m_multisample = enable;
-        m_finalization.set_multisampling(enable);
-        m_fbo.set_multisample(enable);
+
+        // Layered framebuffers are never multisampled, the framebuffer is
+        // picked with the next frame.
+        m_finalization.set_multisampling(enable && m_num_views == 0);
     }
 }
 
-float const*
-SplatRenderer::material_color() const
+unsigned int
+SplatRenderer::samples() const
 {
-    return m_color.data();
+    return m_multisample ? m_samples : 1;
 }
 
 void
-SplatRenderer::set_material_color(float const* color_ptr)
+SplatRenderer::set_samples(unsigned int samples)
 {
-    Map<const Vector3f> color(color_ptr);
-    m_color = color;
+    if (samples <= 1)
+    {
+        set_multisample(false);
+        return;
+    }
+
+    GLint max_color_samples, max_depth_samples;
+    glGetIntegerv(GL_MAX_COLOR_TEXTURE_SAMPLES, &max_color_samples);
+    glGetIntegerv(GL_MAX_DEPTH_TEXTURE_SAMPLES, &max_depth_samples);
+
+    unsigned int max_samples = static_cast<unsigned int>(std::min(
+        std::min(max_color_samples, max_depth_samples), 8));
+
+    if (max_samples < 2)
+    {
+        std::cerr << "Warning: Multisampling is not supported, using 1 "
+            << "sample." << std::endl;
+        set_multisample(false);
+        return;
+    }
+
+    unsigned int supported = 2;
+    while (2 * supported <= std::min(samples, max_samples))
+    {
+        supported *= 2;
+    }
+
+    if (supported != samples)
+    {
+        std::cerr << "Warning: " << samples << " samples are not "
+            << "supported, using " << supported << "." << std::endl;
+    }
+
+    m_samples = supported;
+    m_finalization.set_samples(m_samples);
+
+    set_multisample(true);
 }
 
 float
-SplatRenderer::material_shininess() const
+SplatRenderer::min_sample_shading() const
 {
-    return m_shininess;
+    return m_min_sample_shading;
 }
 
 void
-SplatRenderer::set_material_shininess(float shininess)
+SplatRenderer::set_min_sample_shading(float fraction)
 {
-    m_shininess = shininess;
+    m_min_sample_shading = std::min(std::max(fraction, 0.0f), 1.0f);
 }
 
-float
-SplatRenderer::radius_scale() const
+bool
+SplatRenderer::conservative_depth() const
 {
-    return m_radius_scale;
+    return m_conservative_depth;
 }
 
 void
-SplatRenderer::set_radius_scale(float radius_scale)
+SplatRenderer::set_conservative_depth(bool enable)
 {
-    m_radius_scale = radius_scale;
-}
+    if (m_conservative_depth != enable)
+    {
+        if (enable && !GLEW_VERSION_4_2 && !GLEW_ARB_conservative_depth)
+        {
+            std::cerr << "Warning: Early depth tests require conservative "
+                << "depth, they stay disabled." << std::endl;
+            return;
+        }
 
-float
-SplatRenderer::ewa_radius() const
-{
-    return m_ewa_radius;
+        m_conservative_depth = enable;
+        m_visibility.set_conservative_depth(enable);
+        m_attribute.set_conservative_depth(enable);
+    }
 }
 
-void
-SplatRenderer::set_ewa_radius(float ewa_radius)
+bool
+SplatRenderer::quads() const
 {
-    m_ewa_radius = ewa_radius;
+    return m_quads;
 }
 
 void
-SplatRenderer::reshape(int width, int height)
+SplatRenderer::set_quads(bool enable)
 {
-    m_fbo.reshape(width, height);
+    if (m_quads != enable)
+    {
+        m_quads = enable;
+        m_visibility.set_quads(enable);
+        m_attribute.set_quads(enable);
+    }
 }
 
-Framebuffer&
-SplatRenderer::framebuffer()
+bool
+SplatRenderer::homography() const
 {
-  return m_fbo;
+    return m_homography;
 }
 
 void
-SplatRenderer::setup_uniforms(glProgram& program)
+SplatRenderer::set_homography(bool enable)
 {
-    m_uniform_camera.set_buffer_data(m_camera);
-    
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    GLviz::Frustum view_frustum = m_camera.get_frustum();
-        
-    m_uniform_raycast.set_buffer_data(
-        m_camera.get_projection_matrix().inverse(),
-        viewport);
-
-    Vector4f frustum_plane[6];
-
-    Matrix4f const& projection_matrix = m_camera.get_projection_matrix();
-    for (unsigned int i(0); i < 6; ++i)
+    if (m_homography != enable)
     {
-        frustum_plane[i] = projection_matrix.row(3) + (-1.0f + 2.0f
-            * static_cast<float>(i % 2)) * projection_matrix.row(i / 2);
+        m_homography = enable;
+        m_visibility.set_homography(enable);
+        m_attribute.set_homography(enable);
     }
-    
-    for (unsigned int i(0); i < 6; ++i)
+}
+
+bool
+SplatRenderer::shared_projection_supported()
+{
+    if (!gpu_culling_supported())
     {
-        frustum_plane[i] = (1.0f / frustum_plane[i].block<3, 1>(
-            0, 0).norm()) * frustum_plane[i];
+        return false;
     }
 
-    m_uniform_frustum.set_buffer_data(frustum_plane);
+    GLint max_blocks = 0;
+    glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &max_blocks);
 
-    m_uniform_parameter.set_buffer_data(
-        m_color, m_shininess, m_radius_scale, m_ewa_radius, m_epsilon
-    );
+    return max_blocks > 0;
 }
 
-void
-SplatRenderer::render_pass(bool depth_only)
-{ 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_PROGRAM_POINT_SIZE);
+bool
+SplatRenderer::shared_projection() const
+{
+    return m_shared_projection;
+}
 
-    if (!depth_only && m_soft_zbuffer)
+void
+SplatRenderer::set_shared_projection(bool enable)
+{
+    if (m_shared_projection != enable)
     {
-        glEnable(GL_BLEND);
-        glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
-        glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ONE);
-    }
-
-    glProgram &program = depth_only ? m_visibility : m_attribute;
-
-    program.use();
+        if (enable && !shared_projection_supported())
+        {
+            std::cerr << "Warning: Sharing the projection of splats "
+                << "requires storage buffers in vertex shaders, it stays "
+                << "disabled." << std::endl;
+            return;
+        }
 
-    if (depth_only)
-    {
-        glDepthMask(GL_TRUE);
-        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        m_shared_projection = enable;
     }
-    else
-    {
-        if (m_soft_zbuffer)
-            glDepthMask(GL_FALSE);
-        else
-            glDepthMask(GL_TRUE);
+}
 
-        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    }
+bool
+SplatRenderer::gpu_culling_supported()
+{
+    return GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader
+        && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_draw_indirect);
+}
 
-    setup_uniforms(program);
+bool
+SplatRenderer::gpu_culling() const
+{
+    return m_gpu_culling;
+}
 
-    if (!depth_only && m_soft_zbuffer && m_ewa_filter)
+void
+SplatRenderer::set_gpu_culling(bool enable)
+{
+    if (m_gpu_culling != enable)
     {
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_1D, m_filter_kernel);
+        if (enable && !gpu_culling_supported())
+        {
+            std::cerr << "Warning: GPU culling requires compute shaders, "
+                << "it stays disabled." << std::endl;
+            return;
+        }
 
-        program.set_uniform_1i("filter_kernel", 1);
+        // Compile the compute shader only once it is actually needed
+        // since it would fail on OpenGL 3.3 contexts.
+        if (enable && !m_culling)
+        {
+            m_culling = std::unique_ptr<ProgramCulling>(
+                new ProgramCulling());
+            m_culling->set_backface_culling(m_backface_culling);
+        }
+
+        m_gpu_culling = enable;
     }
+}
 
-    glBindVertexArray(m_vao);
-    glDrawArrays(GL_POINTS, 0, m_num_pts);
-    glBindVertexArray(0);
+ChunkHierarchy const*
+SplatRenderer::chunk_hierarchy() const
+{
+    return m_chunks;
+}
 
-    program.unuse();
+void
+SplatRenderer::set_chunk_hierarchy(ChunkHierarchy const* hierarchy)
+{
+    m_chunks = hierarchy;
+}
 
-    glDisable(GL_PROGRAM_POINT_SIZE);
-    glDisable(GL_BLEND);
-    glDisable(GL_DEPTH_TEST);
+unsigned int
+SplatRenderer::bin_size() const
+{
+    return m_bin_size;
 }
 
 void
-SplatRenderer::begin_frame()
+SplatRenderer::set_bin_size(unsigned int bin_size)
 {
-    m_fbo.bind();
-
-    glDepthMask(GL_TRUE);
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    
-    glClearColor(0.0, 0.0, 0.0, 0.0);
-    glClearDepth(1.0);
+    m_bin_size = bin_size;
+}
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+bool
+SplatRenderer::front_to_back() const
+{
+    return m_front_to_back;
 }
 
 void
-SplatRenderer::end_frame()
+SplatRenderer::set_front_to_back(bool enable)
 {
-//    m_fbo.unbind();
+    m_front_to_back = enable;
+}
 
-    if (m_multisample)
-    {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, m_fbo.color_texture());
+bool
+SplatRenderer::hiz_culling() const
+{
+    return m_hiz_culling;
+}
 
-        if (m_smooth)
+void
+SplatRenderer::set_hiz_culling(bool enable)
+{
+    if (m_hiz_culling != enable)
+    {
+        if (enable && !gpu_culling_supported())
+        {
+            std::cerr << "Warning: Hi-Z culling requires compute shaders, "
+                << "it stays disabled." << std::endl;
+            return;
+        }
+
+        if (enable && !m_hiz)
+        {
+            for (unsigned int i(0); i < ProgramCulling::num_inputs; ++i)
+            {
+                m_occlusion[i] = std::unique_ptr<ProgramCulling>(
+                    new ProgramCulling(true,
+                    static_cast<ProgramCulling::Input>(i)));
+                m_occlusion[i]->set_backface_culling(m_backface_culling);
+            }
+
+            m_hiz = std::unique_ptr<ProgramHiz>(new ProgramHiz());
+        }
+
+        m_hiz_culling = enable;
+    }
+}
+
+float
+SplatRenderer::compute_rasterization_footprint() const
+{
+    return m_raster_footprint;
+}
+
+void
+SplatRenderer::set_compute_rasterization_footprint(float footprint)
+{
+    if (footprint > 0.0f && !gpu_culling_supported())
+    {
+        std::cerr << "Warning: Compute rasterization requires compute "
+            << "shaders, it stays disabled." << std::endl;
+        return;
+    }
+
+    if (footprint > 0.0f && !m_raster_depth)
+    {
+        m_raster_clear = std::unique_ptr<ProgramRasterization>(
+            new ProgramRasterization(ProgramRasterization::clear_pass));
+        m_raster_depth = std::unique_ptr<ProgramRasterization>(
+            new ProgramRasterization(ProgramRasterization::depth_pass));
+        m_raster_color = std::unique_ptr<ProgramRasterization>(
+            new ProgramRasterization(ProgramRasterization::color_pass));
+
+        m_raster_depth->set_backface_culling(m_backface_culling);
+        m_raster_color->set_backface_culling(m_backface_culling);
+        m_raster_color->set_color_material(m_color_material);
+
+        m_depth_resolve = std::unique_ptr<ProgramDepthResolve>(
+            new ProgramDepthResolve());
+    }
+
+    m_raster_footprint = footprint;
+}
+
+unsigned int
+SplatRenderer::hole_filling() const
+{
+    return m_hole_filling;
+}
+
+void
+SplatRenderer::set_hole_filling(unsigned int levels)
+{
+    if (levels > 0 && !gpu_culling_supported())
+    {
+        std::cerr << "Warning: Hole filling requires compute shaders, "
+            << "it stays disabled." << std::endl;
+        return;
+    }
+
+    if (levels > 0 && !m_pull)
+    {
+        m_pull = std::unique_ptr<ProgramPullPush>(
+            new ProgramPullPush(ProgramPullPush::pull_pass));
+        m_push = std::unique_ptr<ProgramPullPush>(
+            new ProgramPullPush(ProgramPullPush::push_pass));
+        m_hole_fill = std::unique_ptr<ProgramHoleFill>(
+            new ProgramHoleFill());
+    }
+
+    m_hole_filling = levels;
+}
+
+FrameStatistics const&
+SplatRenderer::statistics() const
+{
+    if (m_statistics_pending)
+    {
+        GLuint count;
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_draw_indirect);
+
+        if (m_cull_pass)
+        {
+            glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(GLuint),
+                &count);
+            m_statistics.num_surfels_visible = count;
+        }
+
+        if (m_hiz_pass)
+        {
+            glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, m_command_stride,
+                sizeof(GLuint), &count);
+            m_statistics.num_surfels_unoccluded = count;
+        }
+        else
+        {
+            m_statistics.num_surfels_unoccluded =
+                m_statistics.num_surfels_visible;
+        }
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        m_statistics_pending = false;
+    }
+
+    if (m_counters_pending)
+    {
+        PassStatistics* pass[2] = { &m_statistics.visibility_pass,
+            &m_statistics.attribute_pass };
+
+        for (unsigned int i(0); i < 2; ++i)
+        {
+            if (!m_pass_statistics[i])
+            {
+                continue;
+            }
+
+            GLuint64 value[4];
+            for (unsigned int j(0); j < 4; ++j)
+            {
+                glGetQueryObjectui64v(m_statistics_queries[i][j],
+                    GL_QUERY_RESULT, &value[j]);
+            }
+
+            pass[i]->vertex_invocations = value[0];
+            pass[i]->clipping_input_primitives = value[1];
+            pass[i]->clipping_output_primitives = value[2];
+            pass[i]->fragment_invocations = value[3];
+        }
+
+        if (m_overdraw_counted)
+        {
+            GLuint count;
+
+            glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_overdraw_buffer);
+            glGetBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint),
+                &count);
+            glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+            m_statistics.overdraw_fragments = count;
+        }
+
+        m_counters_pending = false;
+    }
+
+    return m_statistics;
+}
+
+FrameStatistics
+SplatRenderer::queue_statistics()
+{
+    // Without query buffer objects the pipeline statistics only reach the
+    // CPU by waiting for them.
+    if (m_counters_pending && (m_pass_statistics[0] || m_pass_statistics[1])
+        && !query_buffers_supported())
+    {
+        statistics();
+    }
+
+    // The counters known on the CPU are uploaded first, those still on the
+    // GPU overwrite them.
+    Counters counters;
+    PassStatistics const* pass[2] = { &m_statistics.visibility_pass,
+        &m_statistics.attribute_pass };
+
+    for (unsigned int i(0); i < 2; ++i)
+    {
+        counters.pass[i][0] = pass[i]->vertex_invocations;
+        counters.pass[i][1] = pass[i]->clipping_input_primitives;
+        counters.pass[i][2] = pass[i]->clipping_output_primitives;
+        counters.pass[i][3] = pass[i]->fragment_invocations;
+    }
+
+    counters.num_surfels_visible = m_statistics.num_surfels_visible;
+    counters.num_surfels_unoccluded = m_statistics.num_surfels_unoccluded;
+    counters.overdraw_fragments = static_cast<GLuint>(
+        m_statistics.overdraw_fragments);
+    counters.padding = 0;
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_counter_buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, sizeof(Counters), &counters);
+
+    if (m_statistics_pending)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, m_draw_indirect);
+
+        if (m_cull_pass)
+        {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                offsetof(Counters, num_surfels_visible), sizeof(GLuint));
+        }
+
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            m_hiz_pass ? m_command_stride : 0,
+            offsetof(Counters, num_surfels_unoccluded), sizeof(GLuint));
+    }
+
+    if (m_counters_pending && m_overdraw_counted)
+    {
+        // The counter was incremented by the fragment shader.
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, m_overdraw_buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+            offsetof(Counters, overdraw_fragments), sizeof(GLuint));
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (m_counters_pending)
+    {
+        // With a query buffer bound the results are written by the GPU
+        // once available, the pointer is an offset into the buffer.
+        glBindBuffer(GL_QUERY_BUFFER, m_counter_buffer);
+
+        for (unsigned int i(0); i < 2; ++i)
+        {
+            if (!m_pass_statistics[i])
+            {
+                continue;
+            }
+
+            for (unsigned int j(0); j < 4; ++j)
+            {
+                glGetQueryObjectui64v(m_statistics_queries[i][j],
+                    GL_QUERY_RESULT, reinterpret_cast<GLuint64*>(
+                    offsetof(Counters, pass) + (4 * i + j)
+                    * sizeof(GLuint64)));
+            }
+        }
+
+        glBindBuffer(GL_QUERY_BUFFER, 0);
+    }
+
+    return m_statistics;
+}
+
+GLuint
+SplatRenderer::counter_buffer() const
+{
+    return m_counter_buffer;
+}
+
+GLsizeiptr
+SplatRenderer::counter_size()
+{
+    return sizeof(Counters);
+}
+
+void
+SplatRenderer::read_counters(void const* data, FrameStatistics& statistics)
+{
+    Counters counters;
+    std::memcpy(&counters, data, sizeof(Counters));
+
+    PassStatistics* pass[2] = { &statistics.visibility_pass,
+        &statistics.attribute_pass };
+
+    for (unsigned int i(0); i < 2; ++i)
+    {
+        pass[i]->vertex_invocations = counters.pass[i][0];
+        pass[i]->clipping_input_primitives = counters.pass[i][1];
+        pass[i]->clipping_output_primitives = counters.pass[i][2];
+        pass[i]->fragment_invocations = counters.pass[i][3];
+    }
+
+    statistics.num_surfels_visible = counters.num_surfels_visible;
+    statistics.num_surfels_unoccluded = counters.num_surfels_unoccluded;
+    statistics.overdraw_fragments = counters.overdraw_fragments;
+}
+
+bool
+SplatRenderer::pipeline_statistics() const
+{
+    return m_pipeline_statistics;
+}
+
+void
+SplatRenderer::set_pipeline_statistics(bool enable)
+{
+    if (m_pipeline_statistics != enable)
+    {
+        if (enable && !pipeline_statistics_supported()
+            && !atomic_counters_supported())
+        {
+            std::cerr << "Warning: Pipeline statistics require pipeline "
+                << "statistics queries or atomic counters, they stay "
+                << "disabled." << std::endl;
+            return;
+        }
+
+        m_pipeline_statistics = enable;
+        m_attribute.set_overdraw(enable && atomic_counters_supported());
+    }
+}
+
+GpuTimer&
+SplatRenderer::gpu_timer()
+{
+    return m_timer;
+}
+
+float const*
+SplatRenderer::material_color() const
+{
+    return m_color.data();
+}
+
+void
+SplatRenderer::set_material_color(float const* color_ptr)
+{
+    Map<const Vector3f> color(color_ptr);
+    m_color = color;
+}
+
+float
+SplatRenderer::material_shininess() const
+{
+    return m_shininess;
+}
+
+void
+SplatRenderer::set_material_shininess(float shininess)
+{
+    m_shininess = shininess;
+}
+
+float
+SplatRenderer::radius_scale() const
+{
+    return m_radius_scale;
+}
+
+void
+SplatRenderer::set_radius_scale(float radius_scale)
+{
+    m_radius_scale = radius_scale;
+}
+
+float
+SplatRenderer::ewa_radius() const
+{
+    return m_ewa_radius;
+}
+
+void
+SplatRenderer::set_ewa_radius(float ewa_radius)
+{
+    m_ewa_radius = ewa_radius;
+}
+
+float
+SplatRenderer::lod_tolerance() const
+{
+    return m_lod_tolerance;
+}
+
+void
+SplatRenderer::set_lod_tolerance(float lod_tolerance)
+{
+    m_lod_tolerance = lod_tolerance;
+}
+
+void
+SplatRenderer::set_tile(int x, int y, int image_width, int image_height)
+{
+    m_tile_x = x;
+    m_tile_y = y;
+    m_image_width = image_width;
+    m_image_height = image_height;
+}
+
+void
+SplatRenderer::reset_tile()
+{
+    m_image_width = m_image_height = 0;
+}
+
+void
+SplatRenderer::reshape(int width, int height)
+{
+    m_viewport[0] = m_viewport[1] = 0;
+    m_viewport[2] = width;
+    m_viewport[3] = height;
+
+    glViewport(0, 0, width, height);
+
+    select_framebuffer();
+}
+
+Framebuffer&
+SplatRenderer::framebuffer()
+{
+  return *m_fbo;
+}
+
+FramebufferPool&
+SplatRenderer::framebuffer_pool()
+{
+    return m_framebuffers;
+}
+
+OutputTextures const&
+SplatRenderer::render_output(Framebuffer& frame)
+{
+    GLsizei width, height;
+    glBindTexture(GL_TEXTURE_2D, frame.color_texture());
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+
+    if (!m_output)
+    {
+        m_output = std::unique_ptr<ProgramOutput>(new ProgramOutput());
+        glGenFramebuffers(1, &m_output_fbo);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_output_fbo);
+
+    GLenum const attachments[3] = { GL_COLOR_ATTACHMENT0,
+        GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+
+    if (m_output_width != width || m_output_height != height)
+    {
+        GLuint* textures[3] = { &m_output_textures.color,
+            &m_output_textures.depth, &m_output_textures.preview };
+        GLenum internal_formats[3] = { GL_RGBA8UI, GL_R32F, GL_R8UI };
+        GLenum formats[3] = { GL_RGBA_INTEGER, GL_RED, GL_RED_INTEGER };
+        GLenum types[3] = { GL_UNSIGNED_BYTE, GL_FLOAT, GL_UNSIGNED_BYTE };
+
+        for (unsigned int i(0); i < 3; ++i)
+        {
+            glDeleteTextures(1, textures[i]);
+            glGenTextures(1, textures[i]);
+            glBindTexture(GL_TEXTURE_2D, *textures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, internal_formats[i], width, height,
+                0, formats[i], types[i], nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachments[i],
+                GL_TEXTURE_2D, *textures[i], 0);
+        }
+
+        m_output_width = width;
+        m_output_height = height;
+    }
+
+    glDrawBuffers(3, attachments);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glViewport(0, 0, width, height);
+
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, frame.color_texture());
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, frame.depth_texture());
+
+    Matrix4f projection = projection_matrix();
+
+    m_output->use();
+    m_output->set_uniform_1i("color_texture", 3);
+    m_output->set_uniform_1i("depth_texture", 4);
+    m_output->set_uniform_1f("prj_mat22", projection(2, 2));
+    m_output->set_uniform_1f("prj_mat23", projection(2, 3));
+
+    glBindVertexArray(m_rect_vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+
+    m_output->unuse();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    return m_output_textures;
+}
+
+void
+SplatRenderer::select_framebuffer()
+{
+    // The soft z-buffer accumulates weighted colors by blending and needs
+    // a floating point target, otherwise the final 8 bit color is written
+    // right away.
+    FramebufferPool::Key key;
+    key.width = m_viewport[2];
+    key.height = m_viewport[3];
+    key.color_format = m_soft_zbuffer ? GL_RGBA16F : GL_RGBA8;
+    key.samples = m_multisample && m_num_views == 0
+        ? static_cast<GLsizei>(m_samples) : 1;
+    key.layers = static_cast<GLsizei>(m_num_views);
+
+    // A depth texture requested on the previous framebuffer carries over,
+    // the previous one may be released by acquiring the next.
+    bool depth_texture = m_fbo != nullptr && m_fbo->depth_texture_enabled();
+
+    m_fbo = &m_framebuffers.acquire(key);
+
+    // Unit normals need no more than half floats.
+    m_fbo->set_normal_format(GL_RGBA16F);
+
+    if (m_smooth != m_fbo->normal_texture_attached())
+    {
+        if (m_smooth)
+        {
+            m_fbo->attach_normal_texture();
+        }
+        else
+        {
+            m_fbo->detach_normal_texture();
+        }
+    }
+
+    if (depth_texture || m_smooth)
+    {
+        m_fbo->enable_depth_texture();
+    }
+}
+
+void
+SplatRenderer::update_uniforms()
+{
+    m_uniforms.begin_segment();
+
+    Matrix4f const& modelview_matrix = m_camera.get_modelview_matrix();
+    Matrix4f projection = projection_matrix();
+
+    unsigned char* camera = m_uniforms.block(camera_block);
+    camera = copy_matrix(camera, modelview_matrix);
+    camera = copy_matrix(camera, modelview_matrix.inverse().transpose());
+    copy_matrix(camera, projection);
+
+    float viewport[4] = {
+        static_cast<float>(m_viewport[0]),
+        static_cast<float>(m_viewport[1]),
+        static_cast<float>(m_viewport[2]),
+        static_cast<float>(m_viewport[3])
+    };
+
+    unsigned char* raycast = m_uniforms.block(raycast_block);
+    raycast = copy_matrix(raycast, projection.inverse());
+    std::memcpy(raycast, viewport, sizeof(viewport));
+
+    frustum_planes(projection, m_frustum_plane);
+
+    std::memcpy(m_uniforms.block(frustum_block), m_frustum_plane,
+        6 * sizeof(Vector4f));
+
+    float parameter[8] = {
+        m_color.x(), m_color.y(), m_color.z(), m_shininess,
+        m_radius_scale, m_ewa_radius, m_epsilon, lod_scale()
+    };
+
+    std::memcpy(m_uniforms.block(parameter_block), parameter,
+        sizeof(parameter));
+
+    unsigned char* views = m_uniforms.block(views_block);
+    for (unsigned int i(0); i < m_num_views; ++i)
+    {
+        Matrix4f const& view_modelview = m_cameras[i].get_modelview_matrix();
+        Matrix4f const& view_projection =
+            m_cameras[i].get_projection_matrix();
+
+        Vector4f frustum_plane[6];
+        frustum_planes(view_projection, frustum_plane);
+
+        unsigned char* view = views + i * view_size;
+        view = copy_matrix(view, view_modelview);
+        view = copy_matrix(view, view_modelview.inverse().transpose());
+        view = copy_matrix(view, view_projection);
+        view = copy_matrix(view, view_projection.inverse());
+        std::memcpy(view, frustum_plane, 6 * sizeof(Vector4f));
+    }
+
+    m_uniforms.end_segment();
+}
+
+Matrix4f
+SplatRenderer::projection_matrix() const
+{
+    Matrix4f const& projection = m_camera.get_projection_matrix();
+
+    if (m_image_width == 0 || m_image_height == 0)
+    {
+        return projection;
+    }
+
+    // Maps the normalized device coordinates of the tile of the image onto
+    // [-1, 1], i.e. an off-center frustum through the tile.
+    float w = static_cast<float>(m_viewport[2]);
+    float h = static_cast<float>(m_viewport[3]);
+
+    Matrix4f tile = Matrix4f::Identity();
+    tile(0, 0) = static_cast<float>(m_image_width) / w;
+    tile(1, 1) = static_cast<float>(m_image_height) / h;
+    tile(0, 3) = (static_cast<float>(m_image_width - 2 * m_tile_x) - w) / w;
+    tile(1, 3) = (static_cast<float>(m_image_height - 2 * m_tile_y) - h) / h;
+
+    return tile * projection;
+}
+
+float
+SplatRenderer::lod_scale() const
+{
+    // Converts the tolerance in pixels into a geometric error per unit of
+    // distance to the viewer.
+    float focal_length = 0.5f * static_cast<float>(m_viewport[3])
+        * projection_matrix()(1, 1);
+
+    return m_lod_tolerance / focal_length;
+}
+
+float
+SplatRenderer::estimate_footprint(Surfel const* surfels) const
+{
+    Matrix4f const& modelview_matrix = m_camera.get_modelview_matrix();
+    float focal_length = 0.5f * static_cast<float>(m_viewport[3])
+        * projection_matrix()(1, 1);
+
+    // A strided subset of the surfels suffices for the average.
+    unsigned int const num_samples = 1024;
+    unsigned int stride = std::max(m_num_pts / num_samples, 1u);
+
+    float area = 0.0f;
+    unsigned int num_visible = 0;
+
+    for (unsigned int i(0); i < m_num_pts; i += stride)
+    {
+        Surfel const& s = surfels[i];
+
+        Vector4f c_eye = modelview_matrix * Vector4f(s.c.x(), s.c.y(),
+            s.c.z(), 1.0f);
+        float r = m_radius_scale * std::max(s.u.norm(), s.v.norm());
+
+        bool visible = -c_eye.z() > r;
+        for (unsigned int j(0); visible && j < 6; ++j)
+        {
+            visible = m_frustum_plane[j].dot(c_eye) >= -r;
+        }
+
+        if (visible)
+        {
+            float r_scr = focal_length * r / -c_eye.z();
+
+            area += 3.14159265f * r_scr * r_scr;
+            ++num_visible;
+        }
+    }
+
+    return num_visible > 0 ? area / static_cast<float>(num_visible) : 0.0f;
+}
+
+void
+SplatRenderer::framebuffer_size(GLsizei& width, GLsizei& height)
+{
+    glBindTexture(GL_TEXTURE_2D, m_fbo->color_texture());
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void
+SplatRenderer::cull_chunks()
+{
+    Vector4f frustum_plane[6];
+
+    // Planes transform by the transpose of the modelview matrix, which is
+    // rigid and thus keeps them normalized.
+    Matrix4f const& modelview_matrix = m_camera.get_modelview_matrix();
+    for (unsigned int i(0); i < 6; ++i)
+    {
+        frustum_plane[i] = modelview_matrix.transpose() * m_frustum_plane[i];
+    }
+
+    if (m_front_to_back)
+    {
+        Matrix3f rotation = modelview_matrix.topLeftCorner<3, 3>();
+        Vector3f eye = -rotation.transpose()
+            * modelview_matrix.topRightCorner<3, 1>();
+
+        m_chunks->cull(frustum_plane, m_radius_scale, eye, m_draw_first,
+            m_draw_count);
+    }
+    else
+    {
+        m_chunks->cull(frustum_plane, m_radius_scale, m_draw_first,
+            m_draw_count);
+    }
+
+    m_statistics.num_surfels_visible = 0;
+    for (GLsizei count : m_draw_count)
+    {
+        m_statistics.num_surfels_visible += static_cast<unsigned int>(count);
+    }
+
+    m_statistics.num_surfels_unoccluded = m_statistics.num_surfels_visible;
+}
+
+void
+SplatRenderer::bin_surfels(Surfel const* surfels)
+{
+    Matrix4f const& modelview_matrix = m_camera.get_modelview_matrix();
+    Matrix4f projection = projection_matrix();
+
+    unsigned int bins_x = (static_cast<unsigned int>(m_viewport[2])
+        + m_bin_size - 1) / m_bin_size;
+    unsigned int bins_y = (static_cast<unsigned int>(m_viewport[3])
+        + m_bin_size - 1) / m_bin_size;
+
+    // Culled surfels go to an extra bin behind the last one which is not
+    // drawn.
+    unsigned int culled = bins_x * bins_y;
+
+    m_surfel_bin.assign(m_num_pts, culled);
+    m_bin_offset.assign(culled + 1, 0);
+
+    // Only the chunks surviving chunk culling are binned.
+    GLint const all_first = 0;
+    GLsizei const all_count = static_cast<GLsizei>(m_num_pts);
+
+    std::size_t num_ranges = m_draw_ranges ? m_draw_first.size() : 1;
+    GLint const* first = m_draw_ranges ? m_draw_first.data() : &all_first;
+    GLsizei const* count = m_draw_ranges ? m_draw_count.data() : &all_count;
+
+    float w = static_cast<float>(m_viewport[2]);
+    float h = static_cast<float>(m_viewport[3]);
+
+    for (std::size_t k(0); k < num_ranges; ++k)
+    {
+        for (GLint i(first[k]); i < first[k] + count[k]; ++i)
+        {
+            Surfel const& s = surfels[i];
+
+            Vector4f c_eye = modelview_matrix * Vector4f(s.c.x(), s.c.y(),
+                s.c.z(), 1.0f);
+            float r = m_radius_scale * std::max(s.u.norm(), s.v.norm());
+
+            bool visible = true;
+            for (unsigned int j(0); visible && j < 6; ++j)
+            {
+                visible = m_frustum_plane[j].dot(c_eye) >= -r;
+            }
+
+            if (!visible)
+            {
+                continue;
+            }
+
+            // Centers behind the viewer belong to splats reaching through
+            // the near plane, which cover the first bin anyway.
+            unsigned int x = 0, y = 0;
+
+            Vector4f c_clip = projection * c_eye;
+            if (c_clip.w() > 0.0f)
+            {
+                float px = (0.5f * c_clip.x() / c_clip.w() + 0.5f) * w;
+                float py = (0.5f * c_clip.y() / c_clip.w() + 0.5f) * h;
+
+                x = static_cast<unsigned int>(std::min(std::max(px, 0.0f),
+                    w - 1.0f)) / m_bin_size;
+                y = static_cast<unsigned int>(std::min(std::max(py, 0.0f),
+                    h - 1.0f)) / m_bin_size;
+            }
+
+            m_surfel_bin[i] = y * bins_x + x;
+            ++m_bin_offset[m_surfel_bin[i] + 1];
+        }
+    }
+
+    // Counting sort, surfels of a bin stay in the order the ranges are
+    // drawn in.
+    for (unsigned int i(1); i <= culled; ++i)
+    {
+        m_bin_offset[i] += m_bin_offset[i - 1];
+    }
+
+    m_binned.resize(m_bin_offset[culled]);
+
+    for (std::size_t k(0); k < num_ranges; ++k)
+    {
+        for (GLint i(first[k]); i < first[k] + count[k]; ++i)
+        {
+            if (m_surfel_bin[i] != culled)
+            {
+                m_binned[m_bin_offset[m_surfel_bin[i]]++] = i;
+            }
+        }
+    }
+
+    unsigned int num_binned = static_cast<unsigned int>(m_binned.size());
+
+    m_statistics.num_surfels_visible = num_binned;
+    m_statistics.num_surfels_unoccluded = num_binned;
+
+    if (num_binned == 0)
+    {
+        return;
+    }
+
+    // The occlusion pass appends its indices behind those of the bins.
+    reserve_culled_indices(m_hiz_pass ? 2 * m_num_pts : num_binned);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_culled_ibo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GLuint) * num_binned,
+        m_binned.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void
+SplatRenderer::build_hiz()
+{
+    GLsizei width, height;
+    framebuffer_size(width, height);
+
+    GLsizei num_levels = 1;
+    while ((std::max(width, height) >> num_levels) > 0)
+    {
+        ++num_levels;
+    }
+
+    if (m_hiz_width != width || m_hiz_height != height)
+    {
+        glDeleteTextures(1, &m_hiz_texture);
+
+        glGenTextures(1, &m_hiz_texture);
+        glBindTexture(GL_TEXTURE_2D, m_hiz_texture);
+        glTexStorage2D(GL_TEXTURE_2D, num_levels, GL_R32F, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+            GL_NEAREST_MIPMAP_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        m_hiz_width = width;
+        m_hiz_height = height;
+    }
+
+    m_hiz->use();
+    m_hiz->set_uniform_1i("src", 3);
+
+    glActiveTexture(GL_TEXTURE3);
+
+    // Level zero copies the depth texture, every further level reduces
+    // the previous one.
+    for (GLsizei level(0); level < num_levels; ++level)
+    {
+        GLsizei w = std::max(width >> level, 1);
+        GLsizei h = std::max(height >> level, 1);
+
+        if (level == 0)
+        {
+            glBindTexture(GL_TEXTURE_2D, m_fbo->depth_texture());
+        }
+        else
+        {
+            glBindTexture(GL_TEXTURE_2D, m_hiz_texture);
+        }
+
+        m_hiz->set_uniform_1i("src_level", level - 1);
+        glBindImageTexture(0, m_hiz_texture, level, GL_FALSE, 0,
+            GL_WRITE_ONLY, GL_R32F);
+
+        glDispatchCompute(
+            (w + ProgramHiz::work_group_size - 1) / ProgramHiz::work_group_size,
+            (h + ProgramHiz::work_group_size - 1) / ProgramHiz::work_group_size,
+            1);
+
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_hiz->unuse();
+}
+
+void
+SplatRenderer::fill_holes()
+{
+    GLsizei width, height;
+    framebuffer_size(width, height);
+
+    GLsizei num_levels = 1;
+    while (num_levels <= static_cast<GLsizei>(m_hole_filling)
+        && (std::max(width, height) >> num_levels) > 0)
+    {
+        ++num_levels;
+    }
+
+    if (m_pull_push_width != width || m_pull_push_height != height
+        || m_pull_push_levels != num_levels)
+    {
+        glDeleteTextures(1, &m_pull_push_color);
+        glDeleteTextures(1, &m_pull_push_depth);
+        glDeleteTextures(1, &m_fill_texture);
+
+        GLuint* textures[3] = { &m_pull_push_color, &m_pull_push_depth,
+            &m_fill_texture };
+        GLenum formats[3] = { GL_RGBA32F, GL_R32F, GL_RGBA32F };
+        GLsizei levels[3] = { num_levels, num_levels, 1 };
+
+        for (unsigned int i(0); i < 3; ++i)
+        {
+            glGenTextures(1, textures[i]);
+            glBindTexture(GL_TEXTURE_2D, *textures[i]);
+            glTexStorage2D(GL_TEXTURE_2D, levels[i], formats[i], width,
+                height);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,
+                GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                GL_NEAREST_MIPMAP_NEAREST);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        m_pull_push_width = width;
+        m_pull_push_height = height;
+        m_pull_push_levels = num_levels;
+    }
+
+    GLuint const group = ProgramPullPush::work_group_size;
+
+    // Level zero copies the framebuffer, every further level pulls from
+    // the previous one.
+    m_pull->use();
+    m_pull->set_uniform_1i("color_src", 3);
+    m_pull->set_uniform_1i("depth_src", 4);
+
+    for (GLsizei level(0); level < num_levels; ++level)
+    {
+        GLsizei w = std::max(width >> level, 1);
+        GLsizei h = std::max(height >> level, 1);
+
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, level == 0 ? m_fbo->color_texture()
+            : m_pull_push_color);
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_2D, level == 0 ? m_fbo->depth_texture()
+            : m_pull_push_depth);
+
+        m_pull->set_uniform_1i("src_level", level - 1);
+        glBindImageTexture(0, m_pull_push_color, level, GL_FALSE, 0,
+            GL_WRITE_ONLY, GL_RGBA32F);
+        glBindImageTexture(1, m_pull_push_depth, level, GL_FALSE, 0,
+            GL_WRITE_ONLY, GL_R32F);
+
+        glDispatchCompute((w + group - 1) / group, (h + group - 1) / group,
+            1);
+
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    m_pull->unuse();
+
+    // Push from the coarsest level down, level zero writes the holes.
+    m_push->use();
+    m_push->set_uniform_1i("color_src", 3);
+    m_push->set_uniform_1i("depth_src", 4);
+
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, m_pull_push_color);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, m_pull_push_depth);
+
+    glBindImageTexture(2, m_fill_texture, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+        GL_RGBA32F);
+
+    for (GLsizei level(num_levels - 2); level >= 0; --level)
+    {
+        GLsizei w = std::max(width >> level, 1);
+        GLsizei h = std::max(height >> level, 1);
+
+        m_push->set_uniform_1i("dst_level", level);
+        glBindImageTexture(0, m_pull_push_color, level, GL_FALSE, 0,
+            GL_WRITE_ONLY, GL_RGBA32F);
+        glBindImageTexture(1, m_pull_push_depth, level, GL_FALSE, 0,
+            GL_WRITE_ONLY, GL_R32F);
+
+        glDispatchCompute((w + group - 1) / group, (h + group - 1) / group,
+            1);
+
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    m_push->unuse();
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+    glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindImageTexture(2, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // The filled holes are drawn into the framebuffer with their depth,
+    // which is only written with the depth test enabled.
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_ALWAYS);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, m_fill_texture);
+
+    m_hole_fill->use();
+    m_hole_fill->set_uniform_1i("fill_texture", 3);
+
+    glBindVertexArray(m_rect_vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+
+    m_hole_fill->unuse();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glDepthFunc(GL_LESS);
+    glDisable(GL_DEPTH_TEST);
+}
+
+void
+SplatRenderer::reserve_culled_indices(unsigned int capacity)
+{
+    if (m_culled_capacity < capacity)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_culled_ibo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GLuint) * capacity, nullptr,
+            GL_DYNAMIC_COPY);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        m_culled_capacity = capacity;
+    }
+}
+
+unsigned int
+SplatRenderer::upload_chunks()
+{
+    // Center, extent and splat radius of the bounds followed by the first
+    // surfel and the number of surfels, padded to the 32 bytes of the
+    // struct in the compute shader.
+    struct Chunk
+    {
+        float center[3];
+        float extent;
+        float radius;
+        GLuint first, count, padding;
+    };
+
+    std::vector<Chunk> chunks;
+
+    GLint const chunk_size = static_cast<GLint>(m_chunks->chunk_size());
+
+    // Ranges are made of whole chunks, merged where adjacent.
+    for (std::size_t k(0); k < m_draw_first.size(); ++k)
+    {
+        GLint end = m_draw_first[k] + m_draw_count[k];
+
+        for (GLint first(m_draw_first[k]); first < end; first += chunk_size)
+        {
+            Vector3f box_min, box_max;
+            Chunk chunk;
+
+            m_chunks->chunk_bounds(static_cast<unsigned int>(first
+                / chunk_size), box_min, box_max, chunk.radius);
+
+            Vector3f center = 0.5f * (box_min + box_max);
+
+            chunk.center[0] = center.x();
+            chunk.center[1] = center.y();
+            chunk.center[2] = center.z();
+            chunk.extent = 0.5f * (box_max - box_min).norm();
+            chunk.first = static_cast<GLuint>(first);
+            chunk.count = static_cast<GLuint>(std::min(chunk_size,
+                end - first));
+            chunk.padding = 0;
+
+            chunks.push_back(chunk);
+        }
+    }
+
+    if (!chunks.empty())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_chunk_buffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Chunk) * chunks.size(),
+            chunks.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    return static_cast<unsigned int>(chunks.size());
+}
+
+void
+SplatRenderer::cull_pass(bool occlusion)
+{
+    // The indices of the occlusion pass follow those of the frustum
+    // culling pass, the buffer must not be reallocated in between.
+    reserve_culled_indices(m_hiz_pass ? 2 * m_num_pts : m_num_pts);
+
+    // The occlusion pass only tests the surfels the visibility pass drew,
+    // such that the attribute pass draws a subset of them.
+    ProgramCulling::Input input = ProgramCulling::all_surfels;
+    unsigned int num_items = m_num_pts;
+
+    if (occlusion && (m_cull_pass || m_bin_pass))
+    {
+        input = ProgramCulling::surfel_list;
+
+        if (m_bin_pass)
+        {
+            num_items = static_cast<unsigned int>(m_binned.size());
+        }
+    }
+    else if (occlusion && m_draw_ranges)
+    {
+        input = ProgramCulling::chunk_list;
+        num_items = upload_chunks();
+    }
+
+    ProgramCulling& program = occlusion ? *m_occlusion[input] : *m_culling;
+    GLintptr offset = occlusion ? m_command_stride : 0;
+
+    // Reset the command, the compute shader only accumulates its count.
+    GLuint command[5] = { 0, 1, occlusion ? m_num_pts : 0, 0, 0 };
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_draw_indirect);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offset, sizeof(command),
+        command);
+
+    // Binned surfels are counted on the CPU, the unused command of the
+    // culling pass passes their count on.
+    if (input == ProgramCulling::surfel_list && m_bin_pass)
+    {
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(GLuint),
+            &num_items);
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    if (num_items == 0)
+    {
+        return;
+    }
+
+    program.use();
+
+    program.set_uniform_1i("num_pts", static_cast<GLint>(m_num_pts));
+
+    if (occlusion)
+    {
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, m_hiz_texture);
+
+        program.set_uniform_1i("hiz", 3);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_vbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_culled_ibo);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, m_draw_indirect, offset,
+        sizeof(command));
+
+    if (input == ProgramCulling::surfel_list)
+    {
+        // The list is read from the front of the buffer the new indices
+        // are appended to.
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, m_culled_ibo, 0,
+            sizeof(GLuint) * m_num_pts);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 4, m_draw_indirect, 0,
+            sizeof(command));
+    }
+    else if (input == ProgramCulling::chunk_list)
+    {
+        program.set_uniform_1i("num_chunks", static_cast<GLint>(num_items));
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_chunk_buffer);
+    }
+
+    // Chunks are processed by a work group each.
+    dispatch_compute_1d(num_items, input == ProgramCulling::chunk_list ? 1
+        : ProgramCulling::work_group_size);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, 0);
+
+    if (occlusion)
+    {
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    program.unuse();
+
+    // The counts are also copied into the counter buffer of the statistics.
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT
+        | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void
+SplatRenderer::rasterize_pass()
+{
+    GLsizei width, height;
+    framebuffer_size(width, height);
+
+    if (m_raster_width != width || m_raster_height != height)
+    {
+        glDeleteTextures(1, &m_raster_texture);
+
+        glGenTextures(1, &m_raster_texture);
+        glBindTexture(GL_TEXTURE_2D, m_raster_texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        m_raster_width = width;
+        m_raster_height = height;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_vbo);
+    glBindImageTexture(0, m_raster_texture, 0, GL_FALSE, 0, GL_READ_WRITE,
+        GL_R32UI);
+    glBindImageTexture(1, m_fbo->color_texture(), 0, GL_FALSE, 0,
+        GL_WRITE_ONLY, GL_RGBA8);
+
+    m_raster_clear->use();
+    dispatch_compute_1d(static_cast<GLuint>(width * height),
+        ProgramRasterization::work_group_size);
+    m_raster_clear->unuse();
+
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    m_raster_depth->use();
+    m_raster_depth->set_uniform_1i("num_pts", static_cast<GLint>(m_num_pts));
+    dispatch_compute_1d(m_num_pts, ProgramRasterization::work_group_size);
+    m_raster_depth->unuse();
+
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    m_raster_color->use();
+    m_raster_color->set_uniform_1i("num_pts", static_cast<GLint>(m_num_pts));
+    dispatch_compute_1d(m_num_pts, ProgramRasterization::work_group_size);
+    m_raster_color->unuse();
+
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT
+        | GL_FRAMEBUFFER_BARRIER_BIT);
+
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    glBindImageTexture(1, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+    // The depth is needed by the finalization and for reading it back.
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, m_raster_texture);
+
+    m_depth_resolve->use();
+    m_depth_resolve->set_uniform_1i("depth_texture", 3);
+
+    glBindVertexArray(m_rect_vao);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+
+    m_depth_resolve->unuse();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDisable(GL_DEPTH_TEST);
+}
+
+void
+SplatRenderer::render_pass(bool depth_only)
+{ 
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    if (!depth_only && m_soft_zbuffer)
+    {
+        glEnable(GL_BLEND);
+        glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+        glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ONE);
+    }
+
+    glProgram &program = depth_only ? m_visibility : m_attribute;
+
+    program.use();
+
+    if (depth_only)
+    {
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    }
+    else
+    {
+        if (m_soft_zbuffer)
+            glDepthMask(GL_FALSE);
+        else
+            glDepthMask(GL_TRUE);
+
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    if (!depth_only && m_soft_zbuffer && m_ewa_filter)
+    {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_1D, m_filter_kernel);
+
+        program.set_uniform_1i("filter_kernel", 1);
+    }
+
+    // The visibility pass stores the projection of every splat it draws,
+    // the attribute pass draws a subset of them.
+    if (m_share_pass)
+    {
+        if (!depth_only)
+        {
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+
+        if (m_num_views > 0)
+        {
+            program.set_uniform_1i("num_pts", static_cast<GLint>(m_num_pts));
+        }
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_projection_buffer);
+    }
+
+    glBindVertexArray(m_vao);
+
+    if (!depth_only && m_hiz_pass)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_draw_indirect);
+        glDrawElementsIndirect(GL_POINTS, GL_UNSIGNED_INT,
+            reinterpret_cast<GLvoid const*>(m_command_stride));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else if (m_cull_pass)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_draw_indirect);
+        glDrawElementsIndirect(GL_POINTS, GL_UNSIGNED_INT, nullptr);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else if (m_bin_pass)
+    {
+        glDrawElements(GL_POINTS, static_cast<GLsizei>(m_binned.size()),
+            GL_UNSIGNED_INT, nullptr);
+    }
+    else if (m_draw_ranges)
+    {
+        glMultiDrawArrays(GL_POINTS, m_draw_first.data(),
+            m_draw_count.data(), static_cast<GLsizei>(m_draw_first.size()));
+    }
+    else if (m_num_views > 0)
+    {
+        glDrawArraysInstanced(GL_POINTS, 0, m_num_pts, m_num_views);
+    }
+    else
+    {
+        glDrawArrays(GL_POINTS, 0, m_num_pts);
+    }
+
+    glBindVertexArray(0);
+
+    if (m_share_pass)
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+    }
+
+    program.unuse();
+
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+}
+
+void
+SplatRenderer::begin_frame()
+{
+    m_fbo->bind();
+
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glClearDepth(1.0);
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void
+SplatRenderer::end_frame()
+{
+//    m_fbo->unbind();
+
+    if (m_multisample && m_num_views == 0)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, m_fbo->color_texture());
+
+        if (m_smooth)
+        {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, m_fbo->normal_texture());
+
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, m_fbo->depth_texture());
+        }
+    }
+    else if (m_num_views > 0)
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_fbo->color_texture());
+
+        if (m_smooth)
         {
             glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, m_fbo.normal_texture());
+            glBindTexture(GL_TEXTURE_2D_ARRAY, m_fbo->normal_texture());
 
             glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, m_fbo.depth_texture());
+            glBindTexture(GL_TEXTURE_2D_ARRAY, m_fbo->depth_texture());
         }
     }
     else
     {
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_fbo.color_texture());
+        glBindTexture(GL_TEXTURE_2D, m_fbo->color_texture());
 
         if (m_smooth)
         {
             glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, m_fbo.normal_texture());
+            glBindTexture(GL_TEXTURE_2D, m_fbo->normal_texture());
 
             glActiveTexture(GL_TEXTURE2);
-            glBindTexture(GL_TEXTURE_2D, m_fbo.depth_texture());
+            glBindTexture(GL_TEXTURE_2D, m_fbo->depth_texture());
         }
     }
 
@@ -580,7 +2326,6 @@ SplatRenderer::end_frame()
     
     try
     {
-        setup_uniforms(m_finalization);
         m_finalization.set_uniform_1i("color_texture", 0);
 
         if (m_smooth)
@@ -595,48 +2340,233 @@ SplatRenderer::end_frame()
             << e.what() << std::endl;
     }
 
+    // One screen quad per layer.
     glBindVertexArray(m_rect_vao);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    if (m_num_views > 0)
+    {
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_num_views);
+    }
+    else
+    {
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    }
     glBindVertexArray(0);
 }
 
 void
 SplatRenderer::render_frame(std::vector<Surfel> const& visible_geometry)
 {
+    set_num_views(0);
+    render_surfels(visible_geometry.data(), nullptr,
+        static_cast<unsigned int>(visible_geometry.size()));
+}
+
+void
+SplatRenderer::render_frame(SplatHierarchy const& hierarchy)
+{
+    set_num_views(0);
+
+    Matrix4f const& modelview_matrix = m_camera.get_modelview_matrix();
+    Vector3f eye = -modelview_matrix.topLeftCorner<3, 3>().transpose()
+        * modelview_matrix.topRightCorner<3, 1>();
+
+    float scale = lod_scale();
+
+    m_lod_nodes.clear();
+    m_lod_errors.clear();
+
+    // No node of a block is closer to the viewer than the box of the block,
+    // nodes whose parent error is tolerable even there can not be part of
+    // the cut. Blocks far from a viewer inside the model draw short
+    // prefixes.
+    for (SplatHierarchy::Block const& block : hierarchy.blocks())
+    {
+        float distance = (eye - eye.cwiseMax(block.box_min).cwiseMin(
+            block.box_max)).norm();
+
+        unsigned int count = hierarchy.num_candidates(block,
+            scale * distance);
+
+        m_lod_nodes.insert(m_lod_nodes.end(),
+            hierarchy.nodes().begin() + block.first,
+            hierarchy.nodes().begin() + block.first + count);
+        m_lod_errors.insert(m_lod_errors.end(),
+            hierarchy.errors().begin() + block.first,
+            hierarchy.errors().begin() + block.first + count);
+    }
+
+    if (m_lod_nodes.empty())
+    {
+        render_surfels(hierarchy.nodes().data(), hierarchy.errors().data(),
+            0);
+        return;
+    }
+
+    render_surfels(m_lod_nodes.data(), m_lod_errors.data(),
+        static_cast<unsigned int>(m_lod_nodes.size()));
+}
+
+void
+SplatRenderer::render_frame(std::vector<Surfel> const& visible_geometry,
+    std::vector<GLviz::Camera> const& cameras)
+{
+    if (cameras.empty())
+    {
+        return;
+    }
+
+    if (cameras.size() > max_views)
+    {
+        std::cerr << "Error: At most " << max_views << " views can be "
+            << "rendered in a single frame." << std::endl;
+        return;
+    }
+
+    unsigned int num_views = static_cast<unsigned int>(cameras.size());
+
+    set_num_views(num_views);
+    m_cameras = cameras.data();
+
+    render_surfels(visible_geometry.data(), nullptr,
+        static_cast<unsigned int>(visible_geometry.size()));
+
+    m_cameras = nullptr;
+}
+
+void
+SplatRenderer::set_num_views(unsigned int num_views)
+{
+    if (m_num_views == num_views)
+    {
+        return;
+    }
+
+    bool multiview = num_views > 0;
+
+    m_visibility.set_multiview(multiview);
+    m_attribute.set_multiview(multiview);
+    m_finalization.set_multiview(multiview);
+    m_finalization.set_multisampling(m_multisample && !multiview);
+
+    m_num_views = num_views;
+}
+
+void
+SplatRenderer::render_surfels(Surfel const* surfels, Vector2f const* errors,
+    unsigned int num_pts)
+{
+    m_num_pts = num_pts;
+
+    m_statistics = FrameStatistics();
+    m_statistics.num_surfels = m_num_pts;
+    m_statistics.num_surfels_visible = m_num_pts;
+    m_statistics.num_surfels_unoccluded = m_num_pts;
+    m_statistics.num_pixels = static_cast<GLuint64>(m_viewport[2])
+        * static_cast<GLuint64>(m_viewport[3]) * std::max(m_num_views, 1u);
+    m_statistics_pending = false;
+
+    m_pass_statistics[0] = m_pass_statistics[1] = false;
+    m_overdraw_counted = false;
+
+    m_timer.begin_frame();
+
+    // Everything the passes read from uniform blocks stays the same during
+    // the frame.
+    update_uniforms();
+
+    // Pick the compute rasterizer for views of tiny splats.
+    if (m_raster_footprint > 0.0f && m_num_pts > 0 && !m_soft_zbuffer
+        && !m_multisample && !m_smooth && errors == nullptr
+        && m_num_views == 0)
+    {
+        m_statistics.average_footprint = estimate_footprint(surfels);
+        m_statistics.compute_rasterization =
+            m_statistics.average_footprint < m_raster_footprint;
+    }
+
+    // The pyramid is built from the depth texture, enable it outside of
+    // the frame since this rebinds the framebuffer object.
+    m_cull_pass = m_gpu_culling && m_num_views == 0;
+    m_bin_pass = m_bin_size > 0 && !m_cull_pass && m_num_views == 0;
+    m_hiz_pass = m_hiz_culling && !m_multisample && m_num_views == 0
+        && !m_statistics.compute_rasterization;
+    m_fill_pass = m_hole_filling > 0 && !m_multisample && m_num_views == 0
+        && m_image_width == 0;
+
+    select_framebuffer();
+
+    if ((m_hiz_pass || m_fill_pass) && !m_fbo->depth_texture_enabled())
+    {
+        m_fbo->enable_depth_texture();
+    }
+
     begin_frame();
 
-    m_num_pts = static_cast<unsigned int>(visible_geometry.size());
+    if (m_lod != (errors != nullptr))
+    {
+        m_lod = errors != nullptr;
+
+        m_visibility.set_lod(m_lod);
+        m_attribute.set_lod(m_lod);
+
+        glBindVertexArray(m_vao);
+        if (m_lod)
+        {
+            glEnableVertexAttribArray(5);
+        }
+        else
+        {
+            glDisableVertexAttribArray(5);
+        }
+        glBindVertexArray(0);
+    }
+
+    m_draw_first.clear();
+    m_draw_count.clear();
+    m_draw_ranges = !m_cull_pass && !m_lod && m_num_views == 0
+        && m_chunks != nullptr
+        && m_chunks->num_surfels() == m_num_pts;
 
     if (m_num_pts > 0)
     {
         glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
         glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STATIC_DRAW);
         glBufferData(GL_ARRAY_BUFFER, sizeof(Surfel) * m_num_pts,
-            &visible_geometry.front(), GL_DYNAMIC_DRAW);
+            surfels, GL_DYNAMIC_DRAW);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-        if (m_multisample)
+        if (m_lod)
         {
-            glEnable(GL_MULTISAMPLE);
-            glEnable(GL_SAMPLE_SHADING);
-            glMinSampleShading(4.0);
+            glBindBuffer(GL_ARRAY_BUFFER, m_lod_vbo);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(Vector2f) * m_num_pts,
+                errors, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
         }
 
-        if (m_soft_zbuffer)
+        if (m_statistics.compute_rasterization)
         {
-            render_pass(true);
+            m_timer.begin(GpuTimer::rasterization_pass);
+            rasterize_pass();
+            m_timer.end(GpuTimer::rasterization_pass);
+        }
+        else
+        {
+            render_passes(surfels);
         }
 
-        render_pass(false);
-
-        if (m_multisample)
+        if (m_fill_pass)
         {
-            glDisable(GL_MULTISAMPLE);
-            glDisable(GL_SAMPLE_SHADING);
+            m_timer.begin(GpuTimer::hole_filling_pass);
+            fill_holes();
+            m_timer.end(GpuTimer::hole_filling_pass);
         }
     }
 
+    m_timer.begin(GpuTimer::finalization_pass);
     end_frame();
+    m_timer.end(GpuTimer::finalization_pass);
+
+    m_uniforms.fence();
 
 #ifndef NDEBUG
     GLenum gl_error = glGetError();
@@ -647,3 +2577,132 @@ SplatRenderer::render_frame(std::vector<Surfel> const& visible_geometry)
     }
 #endif
 }
+
+void
+SplatRenderer::render_passes(Surfel const* surfels)
+{
+    bool multisample = m_multisample && m_num_views == 0;
+
+    if (multisample)
+    {
+        glEnable(GL_MULTISAMPLE);
+
+        if (m_min_sample_shading > 0.0f)
+        {
+            glEnable(GL_SAMPLE_SHADING);
+            glMinSampleShading(m_min_sample_shading);
+        }
+    }
+
+    // Quads with the EWA filter are only expanded in the visibility pass,
+    // the attribute pass needs the bounds of their point sprites.
+    m_share_pass = m_shared_projection && (m_soft_zbuffer || m_hiz_pass)
+        && !(m_quads && m_ewa_filter);
+
+    m_visibility.set_capture(m_share_pass);
+    m_attribute.set_captured(m_share_pass);
+
+    if (m_share_pass)
+    {
+        reserve_projection_buffer();
+    }
+
+    if (m_cull_pass)
+    {
+        m_timer.begin(GpuTimer::culling_pass);
+        cull_pass();
+        m_timer.end(GpuTimer::culling_pass);
+    }
+    else if (m_draw_ranges)
+    {
+        cull_chunks();
+    }
+
+    if (m_bin_pass)
+    {
+        bin_surfels(surfels);
+    }
+
+    // Without the soft z-buffer the visibility pass serves as a depth
+    // prepass for the pyramid, its depth is offset by epsilon and thus
+    // the attribute pass still resolves the nearest surfels.
+    if (m_soft_zbuffer || m_hiz_pass)
+    {
+        m_timer.begin(GpuTimer::visibility_pass);
+        begin_pass_statistics(0);
+        render_pass(true);
+        end_pass_statistics(0);
+        m_timer.end(GpuTimer::visibility_pass);
+    }
+
+    if (m_hiz_pass)
+    {
+        m_timer.begin(GpuTimer::occlusion_pass);
+        build_hiz();
+        cull_pass(true);
+        m_timer.end(GpuTimer::occlusion_pass);
+    }
+
+    m_timer.begin(GpuTimer::attribute_pass);
+    begin_pass_statistics(1);
+    render_pass(false);
+    end_pass_statistics(1);
+    m_timer.end(GpuTimer::attribute_pass);
+
+    m_statistics_pending = m_cull_pass || m_hiz_pass;
+    m_counters_pending = m_pass_statistics[0] || m_pass_statistics[1]
+        || m_overdraw_counted;
+
+    if (multisample)
+    {
+        glDisable(GL_MULTISAMPLE);
+        glDisable(GL_SAMPLE_SHADING);
+    }
+}
+
+// Pass 0 is the visibility pass, pass 1 the attribute pass whose overdraw
+// is counted as well.
+void
+SplatRenderer::begin_pass_statistics(unsigned int pass)
+{
+    if (!m_pipeline_statistics)
+    {
+        return;
+    }
+
+    if (pipeline_statistics_supported())
+    {
+        for (unsigned int i(0); i < 4; ++i)
+        {
+            glBeginQuery(pipeline_statistics_targets[i],
+                m_statistics_queries[pass][i]);
+        }
+
+        m_pass_statistics[pass] = true;
+    }
+
+    if (pass == 1 && atomic_counters_supported())
+    {
+        GLuint zero = 0;
+
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, m_overdraw_buffer);
+        glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(GLuint), &zero);
+        glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+
+        glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, m_overdraw_buffer);
+
+        m_overdraw_counted = true;
+    }
+}
+
+void
+SplatRenderer::end_pass_statistics(unsigned int pass)
+{
+    if (m_pass_statistics[pass])
+    {
+        for (unsigned int i(0); i < 4; ++i)
+        {
+            glEndQuery(pipeline_statistics_targets[i]);
+        }
+    }
+}
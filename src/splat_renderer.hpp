@@ -19,13 +19,24 @@
 #define SPLATRENDER_HPP
 
 #include "program_attribute.hpp"
+#include "program_culling.hpp"
+#include "program_depth_resolve.hpp"
 #include "program_finalization.hpp"
+#include "program_hiz.hpp"
+#include "program_hole_fill.hpp"
+#include "program_output.hpp"
+#include "program_pull_push.hpp"
+#include "program_rasterization.hpp"
 
 #include <GLviz/buffer.hpp>
 
 #include "framebuffer.hpp"
+#include "framebuffer_pool.hpp"
+#include "gpu_timer.hpp"
+#include "uniform_ring.hpp"
 
 #include <Eigen/Core>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -44,33 +55,55 @@ struct Surfel
     unsigned int    rgba;   // Color.
 };
 
-class UniformBufferRaycast : public GLviz::glUniformBuffer
-{
+class ChunkHierarchy;
+class SplatHierarchy;
 
-public:
-    UniformBufferRaycast();
+// Textures of the output pass and how to read them.
+struct OutputTextures
+{
+    GLuint color,    // 8 bit RGBA, GL_RGBA_INTEGER and GL_UNSIGNED_BYTE.
+           depth,    // Distance along the view axis, GL_RED and GL_FLOAT.
+           preview;  // 8 bit depth, GL_RED_INTEGER and GL_UNSIGNED_BYTE.
+};
 
-    void set_buffer_data(Eigen::Matrix4f const& projection_matrix_inv,
-        GLint const* viewport);
+// Pipeline statistics counters of a draw pass.
+struct PassStatistics
+{
+    PassStatistics()
+        : vertex_invocations(0), clipping_input_primitives(0),
+          clipping_output_primitives(0), fragment_invocations(0) { }
+
+    GLuint64 vertex_invocations,
+             clipping_input_primitives,
+             clipping_output_primitives,
+             fragment_invocations;
 };
 
-class UniformBufferFrustum : public GLviz::glUniformBuffer
+struct FrameStatistics
 {
+    FrameStatistics()
+        : num_surfels(0), num_surfels_visible(0),
+          num_surfels_unoccluded(0), average_footprint(0.0f),
+          compute_rasterization(false), overdraw_fragments(0),
+          num_pixels(0) { }
 
-public:
-    UniformBufferFrustum();
+    float culled_fraction() const;
+    float occluded_fraction() const;
 
-    void set_buffer_data(Eigen::Vector4f const* frustum_plane);
-};
+    // Fragments inside of the splats per pixel of the attribute pass.
+    float overdraw() const;
 
-class UniformBufferParameter : public GLviz::glUniformBuffer
-{
+    unsigned int num_surfels,             // Surfels passed to render_frame.
+                 num_surfels_visible,     // Surfels left after frustum culling.
+                 num_surfels_unoccluded;  // Surfels left after Hi-Z culling.
 
-public:
-    UniformBufferParameter();
+    float average_footprint;     // Estimated splat area in pixels.
+    bool compute_rasterization;  // Splatted by the compute rasterizer.
 
-    void set_buffer_data(Eigen::Vector3f const& color, float shininess,
-        float radius_scale, float ewa_radius, float epsilon);
+    // Counted if pipeline statistics are enabled.
+    PassStatistics visibility_pass, attribute_pass;
+    GLuint64 overdraw_fragments;
+    GLuint64 num_pixels;          // Pixels of all views.
 };
 
 class SplatRenderer
@@ -82,6 +115,18 @@ public:
 
     void render_frame(std::vector<Surfel> const& visible_geometry);
 
+    // Draws the cut through the hierarchy given by the level of detail
+    // tolerance, chunk culling does not apply.
+    void render_frame(SplatHierarchy const& hierarchy);
+
+    // Renders the surfels once for each camera into the corresponding layer
+    // of a layered framebuffer with a single instanced draw per pass. All
+    // views share the viewport, culling, Hi-Z, compute rasterization and
+    // multisampling do not apply.
+    static unsigned int const max_views = 16;
+    void render_frame(std::vector<Surfel> const& visible_geometry,
+        std::vector<GLviz::Camera> const& cameras);
+
     bool smooth() const;
     void set_smooth(bool enable = true);
 
@@ -103,9 +148,142 @@ public:
     bool ewa_filter() const;
     void set_ewa_filter(bool enable = true);
 
+    // Multisampling uses the number of samples given by set_samples, four
+    // unless set otherwise.
     bool multisample() const;
     void set_multisample(bool enable = true);
 
+    // Samples per pixel, 2, 4 or 8 enable multisampling with that many
+    // samples and 1 disables it. Counts beyond the limit of the
+    // implementation are reduced to the largest supported one.
+    unsigned int samples() const;
+    void set_samples(unsigned int samples);
+
+    // Minimum fraction of the samples of a pixel the fragment shader runs
+    // for when multisampling, 1 shades every sample and 0 disables sample
+    // shading, i.e. shades once per pixel.
+    float min_sample_shading() const;
+    void set_min_sample_shading(float fraction);
+
+    // Places point sprites at the depth of the splat point closest to the
+    // viewer and declares the written depth as never less than that, so
+    // that occluded fragments are rejected by early depth tests before the
+    // ray-splat intersection. Requires OpenGL 4.2 or ARB_conservative_depth.
+    bool conservative_depth() const;
+    void set_conservative_depth(bool enable = true);
+
+    // Draws every splat as the quad circumscribing its projection, which
+    // is generated in a geometry shader, instead of a point sprite. Tight
+    // for oblique splats and not limited by the maximum point size. The
+    // EWA filter draws point sprites in the attribute pass regardless.
+    bool quads() const;
+    void set_quads(bool enable = true);
+
+    // Sets up a homography from window to splat coordinates per splat in
+    // the vertex shader, which leaves a single matrix product and
+    // division per fragment for the ray-splat intersection.
+    bool homography() const;
+    void set_homography(bool enable = true);
+
+    // Keeps the transformed axes and screen bounds of every splat the
+    // visibility pass computes in a storage buffer, from which the
+    // attribute pass reads them instead of projecting the splats again.
+    // Requires OpenGL 4.3 with storage buffers in vertex shaders. Quads
+    // with the EWA filter are bounded differently in both passes and do
+    // not share their projection.
+    static bool shared_projection_supported();
+    bool shared_projection() const;
+    void set_shared_projection(bool enable = true);
+
+    // Culls surfels in a compute prepass and draws the remaining ones
+    // indirectly, requires OpenGL 4.3. The remaining surfels are compacted
+    // by atomic counters, so their draw order differs from frame to frame
+    // and run to run. Blending of the soft z-buffer and pixels shared by
+    // splats of equal depth may thus differ slightly between runs, Hi-Z
+    // culling compacts the same way.
+    static bool gpu_culling_supported();
+    bool gpu_culling() const;
+    void set_gpu_culling(bool enable = true);
+
+    // Culls chunks of the hierarchy on the CPU and draws the visible
+    // ranges only. The hierarchy has to be built over the same surfels
+    // that are passed to render_frame, GPU culling takes precedence.
+    ChunkHierarchy const* chunk_hierarchy() const;
+    void set_chunk_hierarchy(ChunkHierarchy const* hierarchy);
+
+    // Draws the chunks left after chunk culling front to back by the
+    // distance of their centroids to the camera, such that early depth
+    // tests reject more of the fragments hidden behind nearer splats.
+    bool front_to_back() const;
+    void set_front_to_back(bool enable = true);
+
+    // Sorts the surfels of single views by the screen bin of the given
+    // size in pixels their projected center falls into and draws them bin
+    // by bin, which keeps the depth and color writes of consecutive splats
+    // close together. Surfels outside of the frustum are dropped while
+    // binning, zero disables it. The bins are computed on the CPU, GPU
+    // culling takes precedence.
+    unsigned int bin_size() const;
+    void set_bin_size(unsigned int bin_size);
+
+    // Builds a Hi-Z pyramid from the depth of the visibility pass and culls
+    // surfels hidden behind it before the attribute pass. Only the surfels
+    // drawn by the visibility pass are tested, chunks of the hierarchy are
+    // tested as a whole before their surfels. Without the soft z-buffer
+    // the visibility pass runs as a depth prepass. Requires GPU culling
+    // support and is skipped when multisampling.
+    bool hiz_culling() const;
+    void set_hiz_culling(bool enable = true);
+
+    // Splats the surfels in a compute shader instead of drawing point
+    // sprites for views whose estimated average splat area in pixels is
+    // below the given footprint, zero disables it. Requires OpenGL 4.3 and
+    // applies to the hard z-buffer without multisampling, smooth shading
+    // and level of detail only. Splats of equal depth race for the color
+    // of a pixel, which of them wins is not deterministic.
+    float compute_rasterization_footprint() const;
+    void set_compute_rasterization_footprint(float footprint);
+
+    // Fills pixels the splats left empty from a pull-push pyramid over
+    // color and depth with the given number of levels, zero disables it.
+    // Holes are filled from the finest level around them that is more
+    // than half covered, such that holes up to about 2^levels pixels wide
+    // are closed while silhouettes do not grow. Only the nearest surface
+    // of every texel is averaged, background does not bleed into holes of
+    // the foreground. Requires OpenGL 4.3 and applies to single views
+    // without multisampling. Tiles are not filled, the pyramid of a tile
+    // ends at its border and would leave seams between neighbouring tiles.
+    unsigned int hole_filling() const;
+    void set_hole_filling(unsigned int levels);
+
+    // Counts of GPU culled surfels and pipeline statistics are read back
+    // on the first call after a frame, which waits for the passes to
+    // finish.
+    FrameStatistics const& statistics() const;
+
+    // Statistics of the last frame without waiting for the GPU. The counts
+    // still on the GPU are gathered into counter_buffer(), counter_size()
+    // bytes that the next call overwrites, and are missing from the
+    // returned statistics until read_counters() takes them from a copy of
+    // the buffer read back after the frame completed.
+    FrameStatistics queue_statistics();
+    GLuint counter_buffer() const;
+    static GLsizeiptr counter_size();
+    static void read_counters(void const* data, FrameStatistics& statistics);
+
+    // Counts vertex and fragment shader invocations and clipped primitives
+    // of the visibility and attribute passes with pipeline statistics
+    // queries, requires OpenGL 4.6 or ARB_pipeline_statistics_query. The
+    // overdraw of the attribute pass is counted with an atomic counter,
+    // requires OpenGL 4.2 or ARB_shader_atomic_counters.
+    bool pipeline_statistics() const;
+    void set_pipeline_statistics(bool enable = true);
+
+    // Times the passes of every frame on the GPU. The frame stays open
+    // after render_frame, so that reading back its result can be timed as
+    // the readback pass as well.
+    GpuTimer& gpu_timer();
+
     float const* material_color() const;
     void set_material_color(float const* color_ptr);
     float material_shininess() const;
@@ -117,21 +295,66 @@ public:
     float ewa_radius() const;
     void set_ewa_radius(float ewa_radius);
 
+    // Screen space error in pixels tolerated when drawing a hierarchy.
+    float lod_tolerance() const;
+    void set_lod_tolerance(float lod_tolerance);
+
+    // Restricts rendering to a tile of a larger image, the viewport then
+    // covers the tile whose lower left corner is at x, y in pixels of the
+    // image. Geometry is culled against the frustum of the tile.
+    void set_tile(int x, int y, int image_width, int image_height);
+    void reset_tile();
+
+    // Sets the viewport and switches to the framebuffer of the pool
+    // matching its size.
     void reshape(int width, int height);
 
+    // Framebuffer of the last frame. Frames pick a framebuffer of the pool
+    // by the viewport size and the formats of the current configuration.
     Framebuffer& framebuffer();
+    FramebufferPool& framebuffer_pool();
+
+    // Converts a single sampled frame with a depth texture, i.e. the
+    // resolved framebuffer of the last frame of a single view, into the
+    // output images in a single draw. The rows of all of them are top to
+    // bottom and need no conversion on the CPU. The textures stay valid
+    // until the next call.
+    OutputTextures const& render_output(Framebuffer& frame);
 
 private:
     void setup_program_objects();
     void setup_filter_kernel();
     void setup_screen_size_quad();
     void setup_vertex_array_buffer_object();
-
-    void setup_uniforms(glProgram& program);
+    void setup_culling_buffer_objects();
+    void setup_statistics_objects();
+    void reserve_projection_buffer();
+    void reserve_culled_indices(unsigned int capacity);
+    unsigned int upload_chunks();
+
+    void update_uniforms();
+    Eigen::Matrix4f projection_matrix() const;
+    float lod_scale() const;
+    float estimate_footprint(Surfel const* surfels) const;
+    void framebuffer_size(GLsizei& width, GLsizei& height);
+
+    void select_framebuffer();
+    void set_num_views(unsigned int num_views);
+    void render_surfels(Surfel const* surfels,
+        Eigen::Vector2f const* errors, unsigned int num_pts);
 
     void begin_frame();
     void end_frame();
+    void cull_pass(bool occlusion = false);
+    void cull_chunks();
+    void bin_surfels(Surfel const* surfels);
+    void build_hiz();
+    void fill_holes();
+    void rasterize_pass();
     void render_pass(bool depth_only = false);
+    void render_passes(Surfel const* surfels);
+    void begin_pass_statistics(unsigned int pass);
+    void end_pass_statistics(unsigned int pass);
 
 private:
     GLviz::Camera const& m_camera;
@@ -139,25 +362,102 @@ private:
     GLuint m_rect_vertices_vbo, m_rect_texture_uv_vbo,
         m_rect_vao, m_filter_kernel;
 
-    GLuint m_vbo, m_vao;
-    unsigned int m_num_pts;
+    GLuint m_vbo, m_lod_vbo, m_vao;
+    unsigned int m_num_pts, m_num_views;
+
+    GLuint m_culled_ibo, m_draw_indirect;
+    unsigned int m_culled_capacity;
+
+    // Bounds and surfel ranges of the chunks drawn by the visibility pass,
+    // read by the occlusion pass.
+    GLuint m_chunk_buffer;
+    GLintptr m_command_stride;
+
+    GLuint m_hiz_texture;
+    GLsizei m_hiz_width, m_hiz_height;
+
+    GLuint m_raster_texture;
+    GLsizei m_raster_width, m_raster_height;
+
+    // Color and depth pyramid of the hole filling and the filled holes.
+    GLuint m_pull_push_color, m_pull_push_depth, m_fill_texture;
+    GLsizei m_pull_push_width, m_pull_push_height, m_pull_push_levels;
+
+    // Framebuffer and images of the output pass.
+    GLuint m_output_fbo;
+    OutputTextures m_output_textures;
+    GLsizei m_output_width, m_output_height;
+
+    // Projected splats of the visibility pass, one Splat of the vertex
+    // shader of 64 bytes per surfel and view.
+    GLuint m_projection_buffer;
+    GLsizeiptr m_projection_capacity;
 
     ProgramAttribute m_visibility, m_attribute;
     ProgramFinalization m_finalization;
-
-    Framebuffer m_fbo;
+    std::unique_ptr<ProgramCulling> m_culling,
+        m_occlusion[ProgramCulling::num_inputs];
+    std::unique_ptr<ProgramHiz> m_hiz;
+    std::unique_ptr<ProgramRasterization> m_raster_clear, m_raster_depth,
+        m_raster_color;
+    std::unique_ptr<ProgramDepthResolve> m_depth_resolve;
+    std::unique_ptr<ProgramPullPush> m_pull, m_push;
+    std::unique_ptr<ProgramHoleFill> m_hole_fill;
+    std::unique_ptr<ProgramOutput> m_output;
+
+    ChunkHierarchy const* m_chunks;
+    std::vector<GLint> m_draw_first;
+    std::vector<GLsizei> m_draw_count;
+    bool m_draw_ranges;
+
+    // Candidate nodes of the level of detail cut gathered from the blocks
+    // of the hierarchy.
+    std::vector<Surfel> m_lod_nodes;
+    std::vector<Eigen::Vector2f> m_lod_errors;
+
+    // Bin of every surfel, start of every bin and the surfels sorted by
+    // bin as drawn from the index buffer of the culling pass.
+    std::vector<unsigned int> m_surfel_bin, m_bin_offset;
+    std::vector<GLuint> m_binned;
+    unsigned int m_bin_size;
+    bool m_bin_pass;
+
+    mutable FrameStatistics m_statistics;
+    mutable bool m_statistics_pending;
+
+    // Queries of the pipeline statistics of the visibility and attribute
+    // pass and the atomic counter of the overdraw. The counter buffer
+    // gathers the counts of a frame on the GPU.
+    GLuint m_statistics_queries[2][4];
+    GLuint m_overdraw_buffer, m_counter_buffer;
+    bool m_pass_statistics[2], m_overdraw_counted;
+    mutable bool m_counters_pending;
+
+    FramebufferPool m_framebuffers;
+    Framebuffer* m_fbo;
 
     bool m_soft_zbuffer, m_backface_culling, m_smooth,
-        m_color_material, m_ewa_filter, m_multisample;
-    unsigned int m_pointsize_method;
+        m_color_material, m_ewa_filter, m_multisample, m_gpu_culling,
+        m_hiz_culling, m_hiz_pass, m_cull_pass, m_lod,
+        m_pipeline_statistics, m_conservative_depth, m_quads,
+        m_shared_projection, m_share_pass, m_homography, m_front_to_back;
+    unsigned int m_pointsize_method, m_samples, m_hole_filling;
+    bool m_fill_pass;
+    float m_min_sample_shading;
     Eigen::Vector3f m_color;
     float m_epsilon, m_shininess, m_radius_scale,
-        m_ewa_radius;
+        m_ewa_radius, m_lod_tolerance, m_raster_footprint;
+
+    int m_tile_x, m_tile_y, m_image_width, m_image_height;
+
+    // Viewport of the frames as set by reshape and the eye space frustum
+    // planes of the current frame.
+    GLint m_viewport[4];
+    Eigen::Vector4f m_frustum_plane[6];
+    GLviz::Camera const* m_cameras;
 
-    GLviz::UniformBufferCamera m_uniform_camera;
-    UniformBufferRaycast m_uniform_raycast;
-    UniformBufferFrustum m_uniform_frustum;
-    UniformBufferParameter m_uniform_parameter;
+    UniformRing m_uniforms;
+    GpuTimer m_timer;
 };
 
 #endif // SPLATRENDER_HPP
@@ -0,0 +1,131 @@
+#include "uniform_ring.hpp"
+
+UniformRing::UniformRing(std::vector<GLsizeiptr> const& block_sizes)
+    : m_buffer(0), m_block_size(block_sizes), m_segment_size(0),
+      m_mapped(nullptr), m_segment(num_segments - 1)
+{
+    GLint alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    for (GLsizeiptr size : block_sizes)
+    {
+        m_block_offset.push_back(m_segment_size);
+        m_segment_size += (size + alignment - 1) / alignment * alignment;
+    }
+
+    for (unsigned int i(0); i < num_segments; ++i)
+    {
+        m_fence[i] = 0;
+    }
+
+    GLsizeiptr buffer_size = num_segments * m_segment_size;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+
+    if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT
+            | GL_MAP_COHERENT_BIT;
+
+        glBufferStorage(GL_UNIFORM_BUFFER, buffer_size, nullptr, flags);
+        m_mapped = static_cast<unsigned char*>(glMapBufferRange(
+            GL_UNIFORM_BUFFER, 0, buffer_size, flags));
+    }
+    else
+    {
+        glBufferData(GL_UNIFORM_BUFFER, buffer_size, nullptr,
+            GL_DYNAMIC_DRAW);
+        m_staging.resize(m_segment_size);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+UniformRing::~UniformRing()
+{
+    for (unsigned int i(0); i < num_segments; ++i)
+    {
+        if (m_fence[i])
+        {
+            glDeleteSync(m_fence[i]);
+        }
+    }
+
+    if (m_mapped)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    glDeleteBuffers(1, &m_buffer);
+}
+
+void
+UniformRing::begin_segment()
+{
+    m_segment = (m_segment + 1) % num_segments;
+
+    GLsync& fence = m_fence[m_segment];
+    if (fence)
+    {
+        // The segment was written num_segments frames ago, the wait is
+        // usually over right away.
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        while (glClientWaitSync(fence, flags, 1000000)
+            == GL_TIMEOUT_EXPIRED)
+        {
+            flags = 0;
+        }
+
+        glDeleteSync(fence);
+        fence = 0;
+    }
+}
+
+unsigned char*
+UniformRing::block(unsigned int index)
+{
+    if (m_mapped)
+    {
+        return m_mapped + m_segment * m_segment_size
+            + m_block_offset[index];
+    }
+
+    return m_staging.data() + m_block_offset[index];
+}
+
+void
+UniformRing::end_segment()
+{
+    GLintptr segment_offset = m_segment * m_segment_size;
+
+    if (!m_mapped)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, segment_offset, m_segment_size,
+            m_staging.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    for (unsigned int i(0); i < m_block_size.size(); ++i)
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, i, m_buffer,
+            segment_offset + m_block_offset[i], m_block_size[i]);
+    }
+}
+
+void
+UniformRing::fence()
+{
+    if (m_mapped)
+    {
+        if (m_fence[m_segment])
+        {
+            glDeleteSync(m_fence[m_segment]);
+        }
+
+        m_fence[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef UNIFORM_RING_HPP
+#define UNIFORM_RING_HPP
+
+#include <GL/glew.h>
+
+#include <vector>
+
+// Uniform buffer holding the uniform blocks of a frame in one of several
+// segments used in turn. With ARB_buffer_storage the buffer stays
+// persistently mapped and a fence per segment keeps the CPU from
+// overwriting data the GPU may still read. Otherwise every segment is
+// uploaded with a single glBufferSubData.
+class UniformRing
+{
+
+public:
+    static unsigned int const num_segments = 3;
+
+    // Block i is bound to uniform buffer binding point i, every block is
+    // aligned to the uniform buffer offset alignment.
+    explicit UniformRing(std::vector<GLsizeiptr> const& block_sizes);
+    ~UniformRing();
+
+    // Moves on to the next segment, waiting for the GPU to release it.
+    void begin_segment();
+
+    // Memory of a block of the current segment, valid until end_segment.
+    unsigned char* block(unsigned int index);
+
+    // Makes the written blocks visible and binds them.
+    void end_segment();
+
+    // Marks the end of the commands reading the current segment.
+    void fence();
+
+private:
+    GLuint m_buffer;
+    std::vector<GLintptr> m_block_offset;
+    std::vector<GLsizeiptr> m_block_size;
+    GLsizeiptr m_segment_size;
+
+    unsigned char* m_mapped;
+    std::vector<unsigned char> m_staging;
+
+    GLsync m_fence[num_segments];
+    unsigned int m_segment;
+};
+
+#endif // UNIFORM_RING_HPP
@@ -1,64 +1,100 @@
 #include <algorithm>
+#include <filesystem>
 #include <iostream>
 #include <vector>
 
 #include <glm/glm.hpp>
 #include <nlohmann/json.hpp>
 
-#include "stb_image_write.h"
+#include "image_stream.hpp"
 #include "utils.hpp"
-#include "opencv2/imgcodecs.hpp"
 #include "npy.hpp"
 
-void save_png(GLuint texture_id, const std::string &filename) {
+std::vector<float> read_texture(GLuint texture_id, GLenum format, int components) {
   GLint viewport[4];
   glGetIntegerv(GL_VIEWPORT, viewport);
-  auto raw_data = std::vector<float>(4 * viewport[2] * viewport[3]);
+  auto raw_data = std::vector<float>(components * viewport[2] * viewport[3]);
   glBindTexture(GL_TEXTURE_2D, texture_id);
-  glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, (void*)raw_data.data());
-//  glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
-  auto png = std::vector<unsigned char>(4 * viewport[2] * viewport[3]);  // 4=RGBA
-  auto begin = (const float*)raw_data.data();
-  auto end = (const float*)(raw_data.data() + raw_data.size());
-  std::transform(begin, end, png.begin(), [](const float &val){ return (unsigned char)(val * 255.0f); });
-  // OpenGL expects the 0.0 coordinate on the y-axis to be on the bottom side of the image, but images usually
-  // have 0.0 at the top of the y-axis. For now, this unifies output with the visualisation on the screen.
-  stbi_flip_vertically_on_write(true);
-  stbi_write_png(filename.c_str(), viewport[2], viewport[3], 4, png.data(), 4 * viewport[2]);  // 4=RGBA
+  glGetTexImage(GL_TEXTURE_2D, 0, format, GL_FLOAT, (void*)raw_data.data());
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return raw_data;
 }
 
-void save_depth(GLuint texture_id, const std::string &filename, float prj_mat22, float prj_mat23) {
+std::vector<float> read_texture_array(GLuint texture_id, GLenum format, int components) {
   GLint viewport[4];
   glGetIntegerv(GL_VIEWPORT, viewport);
-  auto raw_data = std::vector<float>(viewport[2] * viewport[3]);
-  glBindTexture(GL_TEXTURE_2D, texture_id);
-  glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, (void*)raw_data.data());
+  GLint layers;
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture_id);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_DEPTH, &layers);
+  auto raw_data = std::vector<float>(components * viewport[2] * viewport[3] * layers);
+  // Core OpenGL 3.3 has no way to read a single layer, so the whole array is read at once.
+  glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, format, GL_FLOAT, (void*)raw_data.data());
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  return raw_data;
+}
+
+std::vector<unsigned char> to_rgba8(const float *rgba, int width, int height) {
+  auto rgba8 = std::vector<unsigned char>(4 * width * height);  // 4=RGBA
+  // OpenGL expects the 0.0 coordinate on the y-axis to be on the bottom side of the image, but images usually
+  // have 0.0 at the top of the y-axis. For now, this unifies output with the visualisation on the screen.
+  // Rows are flipped here rather than by the global flag of stb, which is not safe for encoder threads.
+  auto row = (size_t)4 * width;
+  for (int r = 0; r < height; ++r) {
+    auto src = rgba + (height - 1 - r) * row;
+    std::transform(src, src + row, rgba8.begin() + r * row, [](const float &val){ return (unsigned char)(val * 255.0f); });
+  }
+  return rgba8;
+}
+
+void write_color(const float *rgba, int width, int height, const std::string &filename, const ImageEncoder &encoder) {
+  auto rgba8 = to_rgba8(rgba, width, height);
+  encoder.write(filename, rgba8.data(), width, height, 4);  // 4=RGBA
+}
+
+float linearize_depth(float depth, float prj_mat22, float prj_mat23) {
+  if (abs(depth - 1.0f) < 0.00001f)  // To reflect depth of empty spaces handling in the original article.
+    return 0.0f;
+  return 1.0f / (((depth * 2.0f - 1.0f) + prj_mat22) / prj_mat23);
+}
+
+uint8_t depth_to_gray(float linear_depth) {
+  return (uint8_t)std::clamp((255.0f / 100.0f) * linear_depth, 0.0f, 255.0f);
+}
+
+void write_depth(const float *depth, int width, int height, const std::string &filename, float prj_mat22, float prj_mat23,
+                 const ImageEncoder &encoder) {
+  auto raw_data = std::vector<float>(depth, depth + width * height);
   // OpenGL expects the 0.0 coordinate on the y-axis to be on the bottom side of the image, but images usually
   // have 0.0 at the top of the y-axis. For now, this unifies output with the visualisation on the screen.
-  for (int r = 0; r < (viewport[3]/2); ++r)
+  for (int r = 0; r < (height/2); ++r)
   {
-    for (int c = 0; c != viewport[2]; ++c)
+    for (int c = 0; c != width; ++c)
     {
-      std::swap(raw_data[r * viewport[2] + c], raw_data[(viewport[3] - 1 - r) * viewport[2] + c]);
+      std::swap(raw_data[r * width + c], raw_data[(height - 1 - r) * width + c]);
     }
   }
   // Transform depths from the depth buffer from -1,1 to real depths with projection matrix
-  auto && f = [prj_mat22, prj_mat23](float &d){
-    if (abs(d - 1.0f) < 0.00001f)  // To reflect depth of empty spaces handling in the original article.
-      return 0.0f;
-    return 1.0f / (((d * 2.0f - 1.0f) + prj_mat22) / prj_mat23);
-  };
+  auto && f = [prj_mat22, prj_mat23](float &d){ return linearize_depth(d, prj_mat22, prj_mat23); };
   std::transform(raw_data.begin(), raw_data.end(), raw_data.begin(), f);
-  const std::vector<long unsigned> shape{(long unsigned)viewport[3], (long unsigned)viewport[2]};
+  const std::vector<long unsigned> shape{(long unsigned)height, (long unsigned)width};
   const bool fortran_order{false};
   npy::SaveArrayAsNumpy(filename + ".npy", fortran_order, shape.size(), shape.data(), raw_data);
 
-  auto png = std::vector<uint8_t>(viewport[2] * viewport[3]);
+  auto png = std::vector<uint8_t>(width * height);
   auto begin = (const float*)raw_data.data();
   auto end = (const float*)(raw_data.data() + raw_data.size());
-  std::transform(begin, end, png.begin(), [](const float &val){ return (uint8_t)std::clamp((255.0f / 100.0f) * val, 0.0f, 255.0f); });
-  auto img = cv::Mat(viewport[3], viewport[2], CV_8UC1, png.data());
-  cv::imwrite(filename, img);
+  std::transform(begin, end, png.begin(), depth_to_gray);
+  auto preview = std::filesystem::path(filename).replace_extension(ImageEncoder::extension(encoder.format()));
+  encoder.write(preview.string(), png.data(), width, height, 1);
+}
+
+void write_depth(const float *linear_depth, const uint8_t *preview, int width, int height, const std::string &filename,
+                 const ImageEncoder &encoder) {
+  NpyStream npy(filename + ".npy", width, height);
+  npy.write_rows(linear_depth, height);
+  npy.finish();
+  auto preview_path = std::filesystem::path(filename).replace_extension(ImageEncoder::extension(encoder.format()));
+  encoder.write(preview_path.string(), preview, width, height, 1);
 }
 
 std::ostream &glm::operator<<(std::ostream &out, const glm::mat4 &m) {
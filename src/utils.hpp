@@ -1,12 +1,32 @@
 #ifndef SURFACE_SPLATTING_UTILS_HPP
 #define SURFACE_SPLATTING_UTILS_HPP
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <GL/glew.h>
 
-void save_png(GLuint texture_id, const std::string &filename);
-void save_depth(GLuint texture_id, const std::string &filename, float prj_mat22, float prj_mat23);
+#include "image_encoder.hpp"
+
+// Reads a viewport sized 2D texture.
+std::vector<float> read_texture(GLuint texture_id, GLenum format, int components);
+// Reads all layers of a viewport sized 2D array texture, layer after layer.
+std::vector<float> read_texture_array(GLuint texture_id, GLenum format, int components);
+// Top-down 8 bit RGBA of a bottom-up RGBA float image as rendered by OpenGL.
+std::vector<unsigned char> to_rgba8(const float *rgba, int width, int height);
+// Write a bottom-up RGBA float or depth image as rendered by OpenGL.
+void write_color(const float *rgba, int width, int height, const std::string &filename,
+                 const ImageEncoder &encoder = ImageEncoder());
+// Distance along the view axis of a window depth, 0 for the far plane, and its 8 bit visualisation.
+float linearize_depth(float depth, float prj_mat22, float prj_mat23);
+uint8_t depth_to_gray(float linear_depth);
+// The depth is written as .npy next to the given file name, its preview takes the extension of the format.
+void write_depth(const float *depth, int width, int height, const std::string &filename, float prj_mat22, float prj_mat23,
+                 const ImageEncoder &encoder = ImageEncoder());
+// Same for the top-down linear depth and preview of the output pass of the renderer, written as they are.
+void write_depth(const float *linear_depth, const uint8_t *preview, int width, int height, const std::string &filename,
+                 const ImageEncoder &encoder = ImageEncoder());
 
 namespace glm {
     std::ostream &operator<<(std::ostream &out, const glm::mat4 &m);